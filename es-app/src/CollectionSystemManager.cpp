@@ -111,6 +111,7 @@ void CollectionSystemManager::loadCollectionSystems()
 	//TODO: for all collectionsystems, call init();
 	CollectionSystemDecl decl = mCollectionSystemDeclsIndex[myCollectionsName];
 	mCustomCollectionsBundle = createNewCollectionEntry(decl.name, decl, false);
+	initSmartCollectionSystems();
 	if(Settings::getInstance()->getString("CollectionSystemsAuto") != "" || Settings::getInstance()->getString("CollectionSystemsCustom") != "")
 	{
 		// Now see which ones are enabled
@@ -129,7 +130,7 @@ void CollectionSystemManager::loadEnabledListFromSettings()
 
 	// iterate the map
 	//for (std::map<std::string, CollectionSystem>::iterator it = mAutoCollectionSystemsData.begin(); it != mAutoCollectionSystemsData.end(); it++)
-	for(auto collection : mCollectionSystems)
+	for(auto& collection : mCollectionSystems)
 	{
 		collection.second.isEnabled = ((std::find(autoSelected.begin(), autoSelected.end(), collection.first) != autoSelected.end()) ||
 										(std::find(customSelected.begin(), customSelected.end(), collection.first) != customSelected.end()));
@@ -196,88 +197,135 @@ void CollectionSystemManager::refreshCollectionSystems(FileData* file)
 	if (!file->getSystem()->isGameSystem())
 		return;
 
-	std::map<std::string, CollectionSystem> allCollections;
-	allCollections.insert(mAutoCollectionSystemsData.begin(), mAutoCollectionSystemsData.end());
-	allCollections.insert(mCustomCollectionSystemsData.begin(), mCustomCollectionSystemsData.end());
+	// the collections showing the file are found through its entries; of the others only those that take games
+	// in by their metadata can be affected, custom collections only change when they're edited
+	std::vector<CollectionSystem*> affected;
+	if (file->getCollectionEntries())
+	{
+		const std::vector<FileData*>& entries = *file->getCollectionEntries();
+		for (auto it = entries.begin(); it != entries.end(); it++)
+		{
+			auto sysDataIt = mCollectionSystems.find((*it)->getSystem()->getName());
+			if (sysDataIt != mCollectionSystems.end())
+				affected.push_back(&sysDataIt->second);
+		}
+	}
 
-	for(auto sysDataIt = allCollections.begin(); sysDataIt != allCollections.end(); sysDataIt++)
+	for (auto sysDataIt = mCollectionSystems.begin(); sysDataIt != mCollectionSystems.end(); sysDataIt++)
 	{
-		updateCollectionSystem(file, sysDataIt->second);
+		CollectionSystem& sysData = sysDataIt->second;
+		if (sysData.isPopulated && sysData.decl.type != CUSTOM_COLLECTION && !file->getCollectionEntry(sysData.system))
+			affected.push_back(&sysData);
 	}
+
+	for (auto it = affected.begin(); it != affected.end(); it++)
+		updateCollectionSystem(file, **it);
 }
 
-void CollectionSystemManager::updateCollectionSystem(FileData* file, CollectionSystem sysData)
+// whether a collection that picks its games by their metadata should show the file
+bool CollectionSystemManager::belongsInCollection(FileData* file, const CollectionSystem& sysData)
 {
-	if (sysData.isPopulated)
+	switch (sysData.decl.type)
 	{
-		// collection files use the full path as key, to avoid clashes
-		std::string key = file->getFullPath();
+		case AUTO_ALL_GAMES:
+			return includeFileInAutoCollections(file);
+		case AUTO_LAST_PLAYED:
+			return includeFileInAutoCollections(file) && file->metadata.getInt(META_PLAYCOUNT) > 0;
+		case AUTO_FAVORITES:
+			// favorites, hidden and kidgame; the collection is named after the metadata key
+			return file->metadata.get(sysData.decl.name) == "true";
+		case SMART_COLLECTION:
+		{
+			auto query = mSmartCollectionQueries.find(sysData.decl.name);
+			return query != mSmartCollectionQueries.end() && query->second.matches(file) && includeFileInAutoCollections(file);
+		}
+		default:
+			return false;
+	}
+}
 
-		SystemData* curSys = sysData.system;
-		const std::unordered_map<std::string, FileData*>& children = curSys->getRootFolder()->getChildrenByFilename();
-		bool found = children.find(key) != children.end();
-		FileData* rootFolder = curSys->getRootFolder();
-		FileFilterIndex* fileIndex = curSys->getIndex();
-		std::string name = curSys->getName();
+void CollectionSystemManager::updateCollectionSystem(FileData* file, CollectionSystem& sysData)
+{
+	if (!sysData.isPopulated)
+		return;
 
-		if (found) {
-			// if we found it, we need to update it
-			FileData* collectionEntry = children.at(key);
-			// remove from index, so we can re-index metadata after refreshing
-			fileIndex->removeFromIndex(collectionEntry);
-			collectionEntry->refreshMetadata();
-			// found and we are removing
-			if (name == "favorites" && file->metadata.get("favorite") == "false") {
-				// need to check if still marked as favorite, if not remove
-				ViewController::get()->getGameListView(curSys).get()->remove(collectionEntry, false);
+	SystemData* curSys = sysData.system;
+	FileData* rootFolder = curSys->getRootFolder();
+	FileFilterIndex* fileIndex = curSys->getIndex();
+	FileData* collectionEntry = file->getCollectionEntry(curSys);
+	// entries of custom collections stay until they're edited, the others follow the metadata
+	const bool keepsByRule = sysData.decl.type != CUSTOM_COLLECTION;
+	// a collection that links to its games shows the file itself, the entry it leaves is its root folder
+	const bool linked = linksGames(sysData.decl);
+	if (linked && collectionEntry)
+		collectionEntry = file;
+
+	// the others are still in order, only the file that was added or changed needs to find its place
+	const FileData::SortType sortType = getSortTypeFromString(sysData.decl.defaultSort);
+
+	if (collectionEntry) {
+		// remove from index, so we can re-index metadata after refreshing
+		fileIndex->removeFromIndex(collectionEntry);
+		collectionEntry->refreshMetadata();
+		if (keepsByRule && !belongsInCollection(file, sysData))
+		{
+			ViewController::get()->getGameListView(curSys).get()->remove(collectionEntry, false);
+		}
+		else
+		{
+			// re-index with new metadata
+			fileIndex->addToIndex(collectionEntry);
+			if (linked)
+			{
+				// ViewController::onFileChanged goes by the file's system, a linked file is still of its own
+				std::shared_ptr<IGameListView> view = ViewController::get()->getGameListView(curSys);
+				if (rootFolder->sortChild(file, sortType))
+					view->onFileChanged(file, FILE_MOVED);
+				view->onFileChanged(file, FILE_METADATA_CHANGED);
 			}
 			else
 			{
-				// re-index with new metadata
-				fileIndex->addToIndex(collectionEntry);
+				if (rootFolder->sortChild(collectionEntry, sortType))
+					ViewController::get()->onFileChanged(collectionEntry, FILE_MOVED);
 				ViewController::get()->onFileChanged(collectionEntry, FILE_METADATA_CHANGED);
 			}
 		}
-		else
-		{
-			// we didn't find it here - we need to check if we should add it
-			if (name == "recent" && file->metadata.get("playcount") > "0" && includeFileInAutoCollections(file) ||
-				name == "favorites" && file->metadata.get("favorite") == "true") {
-				CollectionFileData* newGame = new CollectionFileData(file, curSys);
-				rootFolder->addChild(newGame);
-				fileIndex->addToIndex(newGame);
-				ViewController::get()->onFileChanged(file, FILE_METADATA_CHANGED);
-				ViewController::get()->getGameListView(curSys)->onFileChanged(newGame, FILE_METADATA_CHANGED);
-			}
-		}
-		rootFolder->sort(getSortTypeFromString(mCollectionSystemDeclsIndex[name].defaultSort));
-		ViewController::get()->onFileChanged(rootFolder, FILE_SORTED);
+	}
+	else if (linked && belongsInCollection(file, sysData))
+	{
+		rootFolder->linkChild(file);
+		fileIndex->addToIndex(file);
+		rootFolder->sortChild(file, sortType);
+		ViewController::get()->getGameListView(curSys)->onFileChanged(file, FILE_METADATA_CHANGED);
+	}
+	else if (keepsByRule && belongsInCollection(file, sysData))
+	{
+		CollectionFileData* newGame = new CollectionFileData(file, curSys);
+		rootFolder->addChild(newGame);
+		fileIndex->addToIndex(newGame);
+		rootFolder->sortChild(newGame, sortType);
+		ViewController::get()->onFileChanged(file, FILE_METADATA_CHANGED);
+		ViewController::get()->getGameListView(curSys)->onFileChanged(newGame, FILE_METADATA_CHANGED);
 	}
 }
 
 // deletes all collection files from collection systems related to the source file
 void CollectionSystemManager::deleteCollectionFiles(FileData* file)
 {
-	// collection files use the full path as key, to avoid clashes
-	std::string key = file->getFullPath();
-	// find games in collection systems
-	std::map<std::string, CollectionSystem> allCollections;
-	allCollections.insert(mAutoCollectionSystemsData.begin(), mAutoCollectionSystemsData.end());
-	allCollections.insert(mCustomCollectionSystemsData.begin(), mCustomCollectionSystemsData.end());
-
-	for(auto sysDataIt = allCollections.begin(); sysDataIt != allCollections.end(); sysDataIt++)
-	{
-		if (sysDataIt->second.isPopulated)
-		{
-			const std::unordered_map<std::string, FileData*>& children = (sysDataIt->second.system)->getRootFolder()->getChildrenByFilename();
+	if (!file->getCollectionEntries())
+		return;
 
-			bool found = children.find(key) != children.end();
-			if (found) {
-				sysDataIt->second.needsSave = true;
-				FileData* collectionEntry = children.at(key);
-				ViewController::get()->getGameListView(sysDataIt->second.system).get()->remove(collectionEntry, false);
-			}
-		}
+	// removing an entry takes it out of the file's list, so work on a copy
+	std::vector<FileData*> entries = *file->getCollectionEntries();
+	for (auto it = entries.begin(); it != entries.end(); it++)
+	{
+		SystemData* collection = (*it)->getSystem();
+		auto sysDataIt = mCollectionSystems.find(collection->getName());
+		if (sysDataIt != mCollectionSystems.end())
+			sysDataIt->second.needsSave = true;
+		// a collection that links to the file lists the file itself, the view only unlinks it
+		FileData* shown = (*it)->linksChildren() ? file : *it;
+		ViewController::get()->getGameListView(collection).get()->remove(shown, false);
 	}
 }
 
@@ -512,6 +560,37 @@ SystemData* CollectionSystemManager::addNewCustomCollection(std::string name)
 	return createNewCollectionEntry(name, decl);
 }
 
+// loads the Smart Collection systems defined by smart-<name>.cfg files, they're populated once enabled
+void CollectionSystemManager::initSmartCollectionSystems()
+{
+	std::vector<std::string> systems = getCollectionsFromConfigFolder("smart-");
+	for (auto nameIt = systems.begin(); nameIt != systems.end(); nameIt++)
+	{
+		if (mCollectionSystems.find(*nameIt) != mCollectionSystems.end())
+		{
+			LOG(LogWarning) << "Ignoring smart collection " << *nameIt << ", there's a collection of that name already";
+			continue;
+		}
+
+		SmartCollectionQuery query;
+		if (!query.load(getSmartCollectionConfigPath(*nameIt)))
+			continue;
+
+		// kept up to date by their query like the automatic collections, they can't be edited by hand
+		CollectionSystemDecl decl = { SMART_COLLECTION, *nameIt, *nameIt, "filename, ascending", *nameIt, false, false };
+
+		CollectionSystem newCollectionData;
+		newCollectionData.system = createNewCollectionEntry(*nameIt, decl, false);
+		newCollectionData.decl = decl;
+		newCollectionData.isEnabled = false;
+		newCollectionData.isPopulated = false;
+		newCollectionData.needsSave = false;
+
+		mCollectionSystems[*nameIt] = newCollectionData;
+		mSmartCollectionQueries[*nameIt] = query;
+	}
+}
+
 // creates a new, empty Collection system, based on the name and declaration
 SystemData* CollectionSystemManager::createNewCollectionEntry(std::string name, CollectionSystemDecl sysDecl, bool index)
 {
@@ -550,21 +629,18 @@ void CollectionSystemManager::AutoCollectionSystem::populateCollection(Collectio
 	{
 		// we won't iterate all collections
 		if ((*sysIt)->isGameSystem() && !(*sysIt)->isCollection()) {
-			std::vector<FileData*> files = (*sysIt)->getRootFolder()->getFilesRecursive(GAME);
+			const std::vector<FileData*>& files = (*sysIt)->getGames();
 			for(auto gameIt = files.begin(); gameIt != files.end(); gameIt++)
 			{
-				bool include = includeFileInAutoCollections((*gameIt));
-				switch(sysDecl.type) {
-					case AUTO_LAST_PLAYED:
-						include = include && (*gameIt)->metadata.get("playcount") > "0";
-						break;
-					case AUTO_FAVORITES:
-						// we may still want to add files we don't want in auto collections in "favorites"
-						include = (*gameIt)->metadata.get("favorite") == "true";
-						break;
-				}
+				// the same rule updateCollectionSystem keeps the collection to afterwards
+				bool include = CollectionSystemManager::get()->belongsInCollection(*gameIt, *sysData);
 
-				if (include) {
+				if (include && linksGames(sysDecl)) {
+					// the game itself, no copy of it and its metadata
+					rootFolder->linkChild(*gameIt);
+					index->addToIndex(*gameIt);
+				}
+				else if (include) {
 					CollectionFileData* newGame = new CollectionFileData(*gameIt, newSys);
 					rootFolder->addChild(newGame);
 					index->addToIndex(newGame);
@@ -597,8 +673,22 @@ void CollectionSystemManager::CustomCollectionSystem::populateCollection(Collect
 	// get Configuration for this Custom System
 	std::ifstream input(path);
 
-	// get all files map
-	std::unordered_map<std::string,FileData*> allFilesMap = getAllGamesCollection()->getRootFolder()->getChildrenByFilename();
+	// get all files map, by the full paths the config file lists
+	std::unordered_map<std::string,FileData*> allFilesMap;
+	for(auto sysIt = SystemData::sSystemVector.begin(); sysIt != SystemData::sSystemVector.end(); sysIt++)
+	{
+		if ((*sysIt)->isGameSystem() && !(*sysIt)->isCollection())
+		{
+			const std::vector<FileData*>& games = (*sysIt)->getGames();
+			std::string path;
+			for(auto gameIt = games.begin(); gameIt != games.end(); gameIt++)
+			{
+				path.clear();
+				(*gameIt)->appendPath(path);
+				allFilesMap[path] = *gameIt;
+			}
+		}
+	}
 
 	// iterate list of files in config file
 
@@ -619,6 +709,37 @@ void CollectionSystemManager::CustomCollectionSystem::populateCollection(Collect
 	updateCollectionFolderMetadata(newSys);
 }
 
+// populates a Smart Collection System; each system's filter index narrows down the games its query can match
+void CollectionSystemManager::populateSmartCollection(CollectionSystem* sysData)
+{
+	SystemData* newSys = sysData->system;
+	FileData* rootFolder = newSys->getRootFolder();
+	FileFilterIndex* index = newSys->getIndex();
+	const SmartCollectionQuery& query = mSmartCollectionQueries.at(sysData->decl.name);
+
+	std::vector<FileData*> games;
+	for(auto sysIt = SystemData::sSystemVector.begin(); sysIt != SystemData::sSystemVector.end(); sysIt++)
+	{
+		// we won't iterate all collections
+		if ((*sysIt)->isGameSystem() && !(*sysIt)->isCollection())
+			query.getMatchingGames(*sysIt, games);
+	}
+
+	for(auto gameIt = games.begin(); gameIt != games.end(); gameIt++)
+	{
+		if (includeFileInAutoCollections(*gameIt))
+		{
+			rootFolder->linkChild(*gameIt);
+			index->addToIndex(*gameIt);
+		}
+	}
+	rootFolder->sort(getSortTypeFromString(sysData->decl.defaultSort));
+	updateCollectionFolderMetadata(newSys);
+	sysData->isPopulated = true;
+
+	LOG(LogInfo) << "Smart collection " << sysData->decl.name << " matched " << rootFolder->getChildren().size() << " games";
+}
+
 /* Handle System View removal and insertion of Collections */
 void CollectionSystemManager::removeCollectionsFromDisplayedSystems()
 {
@@ -652,20 +773,23 @@ void CollectionSystemManager::removeCollectionsFromDisplayedSystems()
 void CollectionSystemManager::addEnabledCollectionsToDisplayedSystems()
 {
 	// add auto enabled ones
-	for (auto collection : mCollectionSystems)
+	for (auto& collection : mCollectionSystems)
 	{
 		if(collection.second.isEnabled)
 		{
 			// check if populated, otherwise populate
 			if (!collection.second.isPopulated)
 			{
-				collection.second.populateCollection();
+				if (collection.second.decl.type == SMART_COLLECTION)
+					populateSmartCollection(&collection.second);
+				else
+					collection.second.populateCollection();
 			}
 			// check if it has its own view
-			if(collection.second.decl.isCustom || themeFolderExists(collection.first) || !Settings::getInstance()->getBool("UseCustomCollectionsSystem"))
+			if(collection.second.decl.isCustom || collection.second.decl.type == SMART_COLLECTION || themeFolderExists(collection.first) || !Settings::getInstance()->getBool("UseCustomCollectionsSystem"))
 			{
 				// exists theme folder, or we chose not to bundle it under the custom-collections system
-				// so we need to create a view
+				// so we need to create a view; smart collections always have their own, as custom ones do
 				SystemData::sSystemVector.push_back(collection.second.system);
 			}
 			else
@@ -792,8 +916,8 @@ std::vector<std::string> CollectionSystemManager::getUnusedSystemsFromTheme()
 	return themeSys;
 }
 
-// returns which collection config files exist in the user folder
-std::vector<std::string> CollectionSystemManager::getCollectionsFromConfigFolder()
+// returns which collection config files with the given prefix (custom- or smart-) exist in the user folder
+std::vector<std::string> CollectionSystemManager::getCollectionsFromConfigFolder(const std::string& prefix)
 {
 	std::vector<std::string> systems;
 	fs::path configPath = getCollectionsFolder();
@@ -810,12 +934,12 @@ std::vector<std::string> CollectionSystemManager::getCollectionsFromConfigFolder
 				std::string filename = file.substr(configPath.string().size());
 
 				// need to confirm filename matches config format
-				if (boost::algorithm::ends_with(filename, ".cfg") && boost::algorithm::starts_with(filename, "custom-") && filename != "custom-.cfg")
+				if (boost::algorithm::ends_with(filename, ".cfg") && boost::algorithm::starts_with(filename, prefix) && filename != prefix + ".cfg")
 				{
-					filename = filename.substr(7, filename.size()-11);
+					filename = filename.substr(prefix.size(), filename.size() - prefix.size() - 4);
 					systems.push_back(filename);
 				}
-				else
+				else if (!boost::algorithm::starts_with(filename, "custom-") && !boost::algorithm::starts_with(filename, "smart-"))
 				{
 					LOG(LogInfo) << "Found non-collection config file in collections folder: " << filename;
 				}
@@ -886,6 +1010,12 @@ std::string getCustomCollectionConfigPath(std::string collectionName)
 	return path.generic_string();
 }
 
+std::string getSmartCollectionConfigPath(const std::string& collectionName)
+{
+	fs::path path = getCollectionsFolder() + "smart-" + collectionName + ".cfg";
+	return path.generic_string();
+}
+
 std::string getCollectionsFolder()
 {
 	return getHomePath() + "/.emulationstation/collections/";
@@ -900,6 +1030,11 @@ bool systemSort(SystemData* sys1, SystemData* sys2)
 	return name1.compare(name2) < 0;
 }
 
+bool linksGames(const CollectionSystemDecl& decl)
+{
+	return decl.type == AUTO_ALL_GAMES || decl.type == SMART_COLLECTION;
+}
+
 /* Handles loading a collection system, creating an empty one, and populating on demand */
 // loads Automatic Collection systems (All, Favorites, Last Played, Hidden, Kidgame)
 
@@ -1002,9 +1137,8 @@ bool CollectionSystemManager::CustomCollectionSystem::toggleGameInCollection(Fil
 			CollectionFileData* newGame = new CollectionFileData(file, sysData);
 			rootFolder->addChild(newGame);
 			fileIndex->addToIndex(newGame);
+			rootFolder->sortChild(newGame, getSortTypeFromString(mEditingCollectionSystemData->decl.defaultSort));
 			ViewController::get()->getGameListView(systemViewToUpdate)->onFileChanged(newGame, FILE_METADATA_CHANGED);
-			rootFolder->sort(getSortTypeFromString(mEditingCollectionSystemData->decl.defaultSort));
-			ViewController::get()->onFileChanged(systemViewToUpdate->getRootFolder(), FILE_SORTED);
 			// add to bundle index as well, if needed
 			if (systemViewToUpdate != sysData)
 			{
@@ -9,6 +9,7 @@
 #include "ThemeData.h"
 #include "FileFilterIndex.h"
 #include "SystemData.h"
+#include "SmartCollectionQuery.h"
 #include "views/ViewController.h"
 
 enum CollectionSystemType
@@ -16,7 +17,8 @@ enum CollectionSystemType
 	AUTO_ALL_GAMES,
 	AUTO_LAST_PLAYED,
 	AUTO_FAVORITES,
-	CUSTOM_COLLECTION
+	CUSTOM_COLLECTION,
+	SMART_COLLECTION // holds the games its query matches, see SmartCollectionQuery
 };
 
 struct CollectionSystemDecl
@@ -84,7 +86,7 @@ public:
 	void updateSystemsList();
 
 	void refreshCollectionSystems(FileData* file);
-	void updateCollectionSystem(FileData* file, CollectionSystem sysData);
+	void updateCollectionSystem(FileData* file, CollectionSystem& sysData);
 	void deleteCollectionFiles(FileData* file);
 
 	//inline std::map<std::string, CollectionSystem> getAutoCollectionSystems() { return mAutoCollectionSystemsData; };
@@ -119,6 +121,7 @@ private:
 	std::map<std::string, CollectionSystem> mCollectionSystems;
 
 	std::map<std::string, CollectionSystem> mEditableCollectionSystemsData;
+	std::map<std::string, SmartCollectionQuery> mSmartCollectionQueries; // by collection name
 
 	Window* mWindow;
 	bool mIsEditingCustom;  // This bool denotes if user is editing any editable collection other than favs.
@@ -127,26 +130,33 @@ private:
 
 	void init();
 	void initCustomCollectionSystems();
+	void initSmartCollectionSystems();
 	SystemData* getAllGamesCollection();
 	SystemData* createNewCollectionEntry(std::string name, CollectionSystemDecl sysDecl, bool index = true);
 	void populateCustomCollection(CollectionSystem* sysData);
+	void populateSmartCollection(CollectionSystem* sysData);
 
 	void removeCollectionsFromDisplayedSystems();
 	void addEnabledCollectionsToDisplayedSystems();
 
 	std::vector<std::string> getSystemsFromConfig();
 	std::vector<std::string> getSystemsFromTheme();
-	std::vector<std::string> getCollectionsFromConfigFolder();
+	std::vector<std::string> getCollectionsFromConfigFolder(const std::string& prefix = "custom-");
 	std::vector<std::string> getCollectionThemeFolders(bool custom);
 	std::vector<std::string> getUserCollectionThemeFolders();
 
 	bool themeFolderExists(std::string folder);
 
 	bool includeFileInAutoCollections(FileData* file);
+	bool belongsInCollection(FileData* file, const CollectionSystem& sysData);
 
 	SystemData* mCustomCollectionsBundle;
 };
 
 std::string getCustomCollectionConfigPath(std::string collectionName);
+std::string getSmartCollectionConfigPath(const std::string& collectionName);
 std::string getCollectionsFolder();
 bool systemSort(SystemData* sys1, SystemData* sys2);
+// whether the collection links to the games of the game systems (FileData::linkChild) instead of holding a
+// CollectionFileData for each; "all games" and the smart collections show the games as they are, there's nothing to copy
+bool linksGames(const CollectionSystemDecl& decl);
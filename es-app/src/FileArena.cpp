@@ -0,0 +1,63 @@
+#include "FileArena.h"
+#include <new>
+
+#define FILE_ARENA_BLOCK_SIZE (64 * 1024)
+
+// everything handed out stays aligned for any type
+#define FILE_ARENA_ALIGN (sizeof(void*) * 2)
+
+FileArena::FileArena() : mPos(NULL), mEnd(NULL), mFreeSlots(NULL)
+{
+}
+
+FileArena::~FileArena()
+{
+	for(auto it = mBlocks.begin(); it != mBlocks.end(); it++)
+		::operator delete(*it);
+}
+
+void* FileArena::allocate(size_t size)
+{
+	size = (size + FILE_ARENA_ALIGN - 1) & ~(size_t)(FILE_ARENA_ALIGN - 1);
+	if(size < sizeof(FreeSlot))
+		size = sizeof(FreeSlot);
+
+	// nodes are nearly all the same size, so looking at the last freed slot is enough
+	if(mFreeSlots != NULL && mFreeSlots->size == size)
+	{
+		FreeSlot* slot = mFreeSlots;
+		mFreeSlots = slot->next;
+		return slot;
+	}
+
+	if(mPos == NULL || (size_t)(mEnd - mPos) < size)
+	{
+		// anything too big for a block gets one of its own, the current block keeps being filled
+		if(size > FILE_ARENA_BLOCK_SIZE / 4)
+		{
+			char* block = (char*)::operator new(size);
+			mBlocks.push_back(block);
+			return block;
+		}
+
+		mPos = (char*)::operator new(FILE_ARENA_BLOCK_SIZE);
+		mEnd = mPos + FILE_ARENA_BLOCK_SIZE;
+		mBlocks.push_back(mPos);
+	}
+
+	void* ptr = mPos;
+	mPos += size;
+	return ptr;
+}
+
+void FileArena::deallocate(void* ptr, size_t size)
+{
+	size = (size + FILE_ARENA_ALIGN - 1) & ~(size_t)(FILE_ARENA_ALIGN - 1);
+	if(size < sizeof(FreeSlot))
+		size = sizeof(FreeSlot);
+
+	FreeSlot* slot = new (ptr) FreeSlot;
+	slot->next = mFreeSlots;
+	slot->size = size;
+	mFreeSlots = slot;
+}
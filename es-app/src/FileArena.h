@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Hands out the memory for the FileData of one system from a few large blocks, so a tree of thousands of
+// nodes is a handful of allocations and is given back in one go when the system is deleted.
+// A node deleted on its own leaves its slot for the next node to be created.
+// Not thread safe: a system's tree is only ever built or changed by one thread at a time.
+class FileArena
+{
+public:
+	FileArena();
+	~FileArena();
+
+	void* allocate(size_t size);
+	void deallocate(void* ptr, size_t size);
+
+	inline size_t getBlockCount() const { return mBlocks.size(); }
+
+private:
+	// a freed slot, reused by the next allocation of the same size
+	struct FreeSlot
+	{
+		FreeSlot* next;
+		size_t size;
+	};
+
+	std::vector<char*> mBlocks;
+	char* mPos;
+	char* mEnd;
+	FreeSlot* mFreeSlots;
+};
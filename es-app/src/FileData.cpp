@@ -2,24 +2,73 @@
 #include "FileSorts.h"
 #include "views/ViewController.h"
 #include "SystemData.h"
+#include "FileArena.h"
 #include "Log.h"
 #include "AudioManager.h"
 #include "VolumeControl.h"
 #include "Util.h"
+#include "PlayStatsJournal.h"
+#include "Settings.h"
+#include <thread>
 
 namespace fs = boost::filesystem;
 
 FileData::FileData(FileType type, const fs::path& path, SystemEnvironmentData* envData, SystemData* system)
-	: mType(type), mPath(path), mSystem(system), mEnvData(envData), mSourceFileData(NULL), mParent(NULL), metadata(type == GAME ? GAME_METADATA : FOLDER_METADATA) // metadata is REALLY set in the constructor!
+	: FileData(type, path.filename().string(), envData, system, new fs::path(path))
+{
+}
+
+FileData::FileData(FileType type, const std::string& name, SystemData* system)
+	: FileData(type, name, system->getSystemEnvData(), system, NULL)
+{
+}
+
+FileData::FileData(FileType type, const std::string& name, SystemEnvironmentData* envData, SystemData* system, fs::path* absolutePath)
+	: metadata(type == GAME ? GAME_METADATA : FOLDER_METADATA), // metadata is REALLY set in the constructor!
+	mSourceFileData(NULL), mParent(NULL), mType(type), mName(name), mAbsolutePath(absolutePath), mEnvData(envData), mSystem(system), mDeletingTree(false), mLinksChildren(false),
+	mSortedByComparator(NULL), mSortedByKey(NULL), mSortedAscending(true), mChildrenGeneration(0), mFilteredIndex(NULL), mFilteredIndexGeneration(0), mFilteredChildrenGeneration(0),
+	mFilterIndexId((unsigned int)-1), mCollectionEntries(NULL)
 {
 	// metadata needs at least a name field (since that's what getName() will return)
 	if(metadata.get("name").empty())
 		metadata.set("name", getDisplayName());
+	metadata.setOwner(this);
 	mSystemName = system->getName();
+
+	if(type == GAME)
+		system->addGame(this);
 }
 
 FileData::~FileData()
 {
+	// CollectionSystemManager::deleteCollectionFiles normally took the game out of its collections
+	// through their views already; anything it missed must not keep pointing here
+	while(mCollectionEntries)
+	{
+		FileData* entry = mCollectionEntries->back();
+		if(entry->mLinksChildren)
+			entry->unlinkChild(this);
+		else
+			delete entry;
+	}
+
+	delete mAbsolutePath;
+
+	// the games stay where they are, they only stop being listed here
+	if(mLinksChildren)
+	{
+		for(auto it = mChildren.begin(); it != mChildren.end(); it++)
+			(*it)->removeCollectionEntry(this);
+		mChildren.clear();
+	}
+
+	// the whole tree, the index and the system's games go together, nothing to unlink from
+	if(mDeletingTree)
+		return;
+
+	if(mType == GAME)
+		mSystem->removeGame(this);
+
 	if(mParent)
 		mParent->removeChild(this);
 
@@ -29,9 +78,54 @@ FileData::~FileData()
 	mChildren.clear();
 }
 
+// every FileData is preceded by the arena it came from, NULL if it came from the heap;
+// the header is as large as the arena's alignment so the node itself stays aligned
+#define FILEDATA_HEADER_SIZE (sizeof(void*) * 2)
+
+void* FileData::operator new(size_t size)
+{
+	char* block = (char*)::operator new(size + FILEDATA_HEADER_SIZE);
+	*(FileArena**)block = NULL;
+	return block + FILEDATA_HEADER_SIZE;
+}
+
+void* FileData::operator new(size_t size, FileArena& arena)
+{
+	char* block = (char*)arena.allocate(size + FILEDATA_HEADER_SIZE);
+	*(FileArena**)block = &arena;
+	return block + FILEDATA_HEADER_SIZE;
+}
+
+void FileData::operator delete(void* ptr, size_t size)
+{
+	if(ptr == NULL)
+		return;
+
+	char* block = (char*)ptr - FILEDATA_HEADER_SIZE;
+	FileArena* arena = *(FileArena**)block;
+	if(arena != NULL)
+		arena->deallocate(block, size + FILEDATA_HEADER_SIZE);
+	else
+		::operator delete(block);
+}
+
+void FileData::operator delete(void* ptr, FileArena& arena)
+{
+	// only called when a constructor throws, the slot is given back with the rest of the arena
+}
+
+void FileData::deleteTree()
+{
+	mDeletingTree = true;
+	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
+		(*it)->deleteTree();
+
+	delete this;
+}
+
 std::string FileData::getDisplayName() const
 {
-	std::string stem = mPath.stem().generic_string();
+	std::string stem = fs::path(mName).stem().generic_string();
 	if(mSystem && mSystem->hasPlatformId(PlatformIds::ARCADE) || mSystem->hasPlatformId(PlatformIds::NEOGEO))
 		stem = PlatformIds::getCleanMameName(stem.c_str());
 
@@ -45,27 +139,37 @@ std::string FileData::getCleanName() const
 
 const std::string& FileData::getThumbnailPath() const
 {
-	if(!metadata.get("thumbnail").empty())
-		return metadata.get("thumbnail");
+	if(!metadata.getString(META_THUMBNAIL).empty())
+		return metadata.getString(META_THUMBNAIL);
 	else
-		return metadata.get("image");
+		return metadata.getString(META_IMAGE);
 }
 
 const std::string& FileData::getName()
 {
-	return metadata.get("name");
+	return metadata.getString(META_NAME);
 }
 
 const std::vector<FileData*>& FileData::getChildrenListToDisplay() {
 
-	FileFilterIndex* idx = CollectionSystemManager::get()->getSystemToView(mSystem)->getIndex();
+	// only collections can be shown through another system, the custom collections bundle when their root
+	// folder hangs in it; that's where CollectionSystemManager::getSystemToView() would look it up
+	FileData* collectionRoot = mSystem->isCollection() ? mSystem->getRootFolder() : NULL;
+	FileFilterIndex* idx = (collectionRoot != NULL && collectionRoot->mParent != NULL) ? collectionRoot->mParent->mSystem->getIndex() : mSystem->getIndex();
 	if (idx->isFiltered()) {
-		mFilteredChildren.clear();
-		for(auto it = mChildren.begin(); it != mChildren.end(); it++)
+		if (mFilteredIndex != idx || mFilteredIndexGeneration != idx->getGeneration() || mFilteredChildrenGeneration != mChildrenGeneration)
 		{
-			if (idx->showFile((*it))) {
-				mFilteredChildren.push_back(*it);
+			mFilteredChildren.clear();
+			for(auto it = mChildren.begin(); it != mChildren.end(); it++)
+			{
+				if (idx->showFile((*it))) {
+					mFilteredChildren.push_back(*it);
+				}
 			}
+
+			mFilteredIndex = idx;
+			mFilteredIndexGeneration = idx->getGeneration();
+			mFilteredChildrenGeneration = mChildrenGeneration;
 		}
 
 		return mFilteredChildren;
@@ -78,12 +182,12 @@ const std::vector<FileData*>& FileData::getChildrenListToDisplay() {
 
 const std::string& FileData::getVideoPath() const
 {
-	return metadata.get("video");
+	return metadata.getString(META_VIDEO);
 }
 
 const std::string& FileData::getMarqueePath() const
 {
-	return metadata.get("marquee");
+	return metadata.getString(META_MARQUEE);
 }
 
 std::vector<FileData*> FileData::getFilesRecursive(unsigned int typeMask, bool displayedOnly) const
@@ -109,7 +213,81 @@ std::vector<FileData*> FileData::getFilesRecursive(unsigned int typeMask, bool d
 	return out;
 }
 
-std::string FileData::getKey() {
+fs::path FileData::getPath() const
+{
+	if(mAbsolutePath != NULL)
+		return *mAbsolutePath;
+
+	std::string path;
+	path.reserve(256);
+	appendPath(path);
+	return path;
+}
+
+void FileData::appendPath(std::string& out) const
+{
+	assert(mAbsolutePath != NULL || mParent != NULL);
+	if(mAbsolutePath != NULL)
+	{
+		out += mAbsolutePath->generic_string();
+		return;
+	}
+
+	mParent->appendPath(out);
+	out += '/';
+	out += mName;
+}
+
+// true if path is our path followed by "/" and name, worked out without building our path
+bool FileData::isPathBelow(const std::string& path, const std::string& name) const
+{
+	if(name.empty() || name.find('/') != std::string::npos || path.size() < name.size() + 1 ||
+		path.compare(path.size() - name.size(), name.size(), name) != 0 || path[path.size() - name.size() - 1] != '/')
+		return false;
+
+	size_t end = path.size() - name.size() - 1;
+
+	for(const FileData* folder = this; ; folder = folder->mParent)
+	{
+		if(folder->mAbsolutePath != NULL)
+		{
+			const std::string& folderPath = folder->mAbsolutePath->string();
+			return end == folderPath.size() && path.compare(0, end, folderPath) == 0;
+		}
+
+		const std::string& folderName = folder->mName;
+		if(end < folderName.size() + 1 || path[end - folderName.size() - 1] != '/' || path.compare(end - folderName.size(), folderName.size(), folderName) != 0)
+			return false;
+
+		end -= folderName.size() + 1;
+	}
+}
+
+// a folder is shown while anything below it is, so whatever is above has to know too
+void FileData::childrenChanged(bool below)
+{
+	mChildrenGeneration++;
+	if(below && mParent != NULL)
+		mParent->childrenChanged(true);
+}
+
+// whether a folder shows a game can depend on its metadata, so the folders it's listed in have to look again
+void FileData::metadataChanged()
+{
+	if(mParent != NULL)
+		mParent->childrenChanged(true);
+
+	if(mCollectionEntries != NULL)
+	{
+		for(auto it = mCollectionEntries->begin(); it != mCollectionEntries->end(); it++)
+		{
+			if((*it)->mLinksChildren)
+				(*it)->childrenChanged(true);
+		}
+	}
+}
+
+const std::string& FileData::getKey() {
 	return getFileName();
 }
 
@@ -118,16 +296,82 @@ FileData* FileData::getSourceFileData()
 	return this;
 }
 
+FileData* FileData::getCollectionEntry(const SystemData* collection) const
+{
+	if(mCollectionEntries)
+	{
+		for(auto it = mCollectionEntries->begin(); it != mCollectionEntries->end(); it++)
+		{
+			if((*it)->getSystem() == collection)
+				return *it;
+		}
+	}
+	return NULL;
+}
+
+FileData* FileData::getListingFolder(const SystemData* system) const
+{
+	if(mCollectionEntries && mSystem != system)
+	{
+		for(auto it = mCollectionEntries->begin(); it != mCollectionEntries->end(); it++)
+		{
+			FileData* entry = *it;
+			if(entry->mLinksChildren && (entry->mSystem == system || (entry->mParent && entry->mParent->mSystem == system)))
+				return entry;
+		}
+	}
+	return mParent;
+}
+
+std::string FileData::getListName(const SystemData* system)
+{
+	if(mType != GAME || mSystem == system || mSourceFileData != NULL)
+		return getName();
+
+	std::string name = removeParenthesis(getName());
+	boost::trim(name);
+	return name + " [" + strToUpper(mSystem->getName()) + "]";
+}
+
+void FileData::addCollectionEntry(FileData* entry)
+{
+	if(!mCollectionEntries)
+		mCollectionEntries = new std::vector<FileData*>();
+	mCollectionEntries->push_back(entry);
+}
+
+void FileData::removeCollectionEntry(FileData* entry)
+{
+	auto it = std::find(mCollectionEntries->begin(), mCollectionEntries->end(), entry);
+	*it = mCollectionEntries->back();
+	mCollectionEntries->pop_back();
+	if(mCollectionEntries->empty())
+	{
+		delete mCollectionEntries;
+		mCollectionEntries = NULL;
+	}
+}
+
 void FileData::addChild(FileData* file)
 {
 	assert(mType == FOLDER);
 	assert(file->getParent() == NULL);
 
-	const std::string key = file->getKey();
+	const std::string& key = file->getKey();
 	if (mChildrenByFilename.find(key) == mChildrenByFilename.end())
 	{
 		mChildrenByFilename[key] = file;
 		mChildren.push_back(file);
+		mSortCaches.clear();
+		childrenChanged(true);
+
+		// most nodes are directly below their folder, they can drop the part of the path that's the folder's
+		if(file->mAbsolutePath != NULL && isPathBelow(file->mAbsolutePath->string(), file->mName))
+		{
+			delete file->mAbsolutePath;
+			file->mAbsolutePath = NULL;
+		}
+
 		file->mParent = this;
 	}
 }
@@ -141,8 +385,14 @@ void FileData::removeChild(FileData* file)
 	{
 		if(*it == file)
 		{
+			// on its own, it needs its full path back
+			if(file->mAbsolutePath == NULL)
+				file->mAbsolutePath = new fs::path(file->getPath());
+
 			file->mParent = NULL;
 			mChildren.erase(it);
+			mSortCaches.clear();
+			childrenChanged(true);
 			return;
 		}
 	}
@@ -152,9 +402,40 @@ void FileData::removeChild(FileData* file)
 
 }
 
+void FileData::linkChild(FileData* game)
+{
+	assert(mType == FOLDER);
+	assert(mLinksChildren || mChildren.empty());
+	assert(game->getCollectionEntry(mSystem) == NULL);
+
+	mLinksChildren = true;
+	mChildren.push_back(game);
+	mSortCaches.clear();
+	childrenChanged(true);
+	game->addCollectionEntry(this);
+}
+
+void FileData::unlinkChild(FileData* game)
+{
+	assert(mLinksChildren);
+
+	auto it = std::find(mChildren.begin(), mChildren.end(), game);
+	assert(it != mChildren.end());
+
+	mChildren.erase(it);
+	mSortCaches.clear();
+	childrenChanged(true);
+	game->removeCollectionEntry(this);
+
+	// like a CollectionFileData going away, the game leaves the collection's filters
+	mSystem->getIndex()->removeFromIndex(game);
+}
+
 void FileData::sort(ComparisonFunction& comparator, bool ascending)
 {
 	std::stable_sort(mChildren.begin(), mChildren.end(), comparator);
+	childrenChanged(false);
+	setSortedBy(&comparator, NULL, ascending);
 
 	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
 	{
@@ -166,9 +447,210 @@ void FileData::sort(ComparisonFunction& comparator, bool ascending)
 		std::reverse(mChildren.begin(), mChildren.end());
 }
 
+// lists at least this long are sorted on several threads, when sorted from the main thread
+#define PARALLEL_SORT_MIN_SIZE 8192
+
+namespace
+{
+	// statics are initialized before main() runs, on its thread
+	const std::thread::id sMainThreadId = std::this_thread::get_id();
+
+	struct KeyedFile
+	{
+		FileData::SortKey key;
+		FileData* file;
+	};
+
+	bool compareSortKeys(const FileData::SortKey& a, const FileData::SortKey& b)
+	{
+		if(a.number != b.number)
+			return a.number < b.number;
+
+		return a.text.compare(b.text) < 0;
+	}
+
+	bool compareKeyedFiles(const KeyedFile& a, const KeyedFile& b)
+	{
+		return compareSortKeys(a.key, b.key);
+	}
+
+	// works out the keys of chunks of the files and sorts those on their own threads, then merges neighbouring
+	// chunks until one is left; merging keeps equal keys of the left chunk first, so the result is as stable
+	// as std::stable_sort. The loader threads already keep every core busy, so they sort on their own.
+	void stableSortByKey(const std::vector<FileData*>& children, FileData::KeyFunction& keyFunction, std::vector<KeyedFile>& files)
+	{
+		files.resize(children.size());
+
+		auto sortChunk = [&children, &keyFunction, &files](size_t first, size_t last)
+		{
+			for(size_t i = first; i < last; i++)
+			{
+				files[i].key.number = 0;
+				keyFunction(children[i], files[i].key);
+				files[i].file = children[i];
+			}
+			std::stable_sort(files.begin() + first, files.begin() + last, compareKeyedFiles);
+		};
+
+		unsigned int chunks = std::thread::hardware_concurrency();
+		if(chunks > files.size() / (PARALLEL_SORT_MIN_SIZE / 4))
+			chunks = files.size() / (PARALLEL_SORT_MIN_SIZE / 4);
+
+		if(files.size() < PARALLEL_SORT_MIN_SIZE || chunks < 2 || std::this_thread::get_id() != sMainThreadId)
+		{
+			sortChunk(0, files.size());
+			return;
+		}
+
+		std::vector<size_t> bounds;
+		for(unsigned int i = 0; i <= chunks; i++)
+			bounds.push_back(files.size() * i / chunks);
+
+		std::vector<std::thread> threads;
+		for(unsigned int i = 0; i < chunks; i++)
+			threads.push_back(std::thread(sortChunk, bounds[i], bounds[i + 1]));
+		for(auto it = threads.begin(); it != threads.end(); it++)
+			it->join();
+
+		for(unsigned int width = 1; width < chunks; width *= 2)
+		{
+			threads.clear();
+			for(unsigned int i = 0; i + width < chunks; i += width * 2)
+			{
+				const size_t first = bounds[i];
+				const size_t middle = bounds[i + width];
+				const size_t last = bounds[std::min(i + width * 2, chunks)];
+				threads.push_back(std::thread([&files, first, middle, last] { std::inplace_merge(files.begin() + first, files.begin() + middle, files.begin() + last, compareKeyedFiles); }));
+			}
+			for(auto it = threads.begin(); it != threads.end(); it++)
+				it->join();
+		}
+	}
+}
+
+unsigned long long FileData::getChildrenMetadataVersions() const
+{
+	unsigned long long versions = 0;
+	for(auto it = mChildren.cbegin(); it != mChildren.cend(); it++)
+		versions += (*it)->metadata.getVersion();
+
+	return versions;
+}
+
+void FileData::sort(KeyFunction& keyFunction, bool ascending)
+{
+	const unsigned long long versions = getChildrenMetadataVersions();
+
+	SortCache* cache = NULL;
+	for(auto it = mSortCaches.begin(); it != mSortCaches.end(); it++)
+	{
+		if(it->keyFunction == &keyFunction)
+		{
+			cache = &(*it);
+			break;
+		}
+	}
+
+	childrenChanged(false);
+	setSortedBy(NULL, &keyFunction, ascending);
+
+	if(cache != NULL && cache->metadataVersions == versions)
+	{
+		mChildren = cache->children;
+	}else{
+		std::vector<KeyedFile> files;
+		stableSortByKey(mChildren, keyFunction, files);
+
+		for(size_t i = 0; i < files.size(); i++)
+			mChildren[i] = files[i].file;
+
+		if(cache == NULL)
+		{
+			mSortCaches.push_back(SortCache());
+			cache = &mSortCaches.back();
+			cache->keyFunction = &keyFunction;
+		}
+		cache->metadataVersions = versions;
+		cache->children = mChildren;
+	}
+
+	for(auto it = mChildren.begin(); it != mChildren.end(); it++)
+	{
+		if((*it)->getChildren().size() > 0)
+			(*it)->sort(keyFunction, ascending);
+	}
+
+	if(!ascending)
+		std::reverse(mChildren.begin(), mChildren.end());
+}
+
+void FileData::setSortedBy(ComparisonFunction* comparator, KeyFunction* keyFunction, bool ascending)
+{
+	mSortedByComparator = comparator;
+	mSortedByKey = keyFunction;
+	mSortedAscending = ascending;
+}
+
+FileData::SortType FileData::getSortType(const SortType& defaultType) const
+{
+	if(mSortedByComparator == NULL && mSortedByKey == NULL)
+		return defaultType;
+
+	return SortType(mSortedByComparator, mSortedByKey, mSortedAscending, "");
+}
+
+bool FileData::sortChild(FileData* file, const SortType& defaultType)
+{
+	// the children are only in order by the sort they were last put in, which the user may have picked
+	if(mSortedByComparator == NULL && mSortedByKey == NULL)
+	{
+		sort(defaultType);
+		return true;
+	}
+	const SortType type = getSortType(defaultType);
+
+	auto it = std::find(mChildren.begin(), mChildren.end(), file);
+	assert(it != mChildren.end());
+
+	const size_t from = it - mChildren.begin();
+	mChildren.erase(it);
+
+	SortKey fileKey;
+	fileKey.number = 0;
+	if(type.keyFunction != NULL)
+		type.keyFunction(file, fileKey);
+
+	// only the children the search looks at get their key worked out
+	auto sortsBefore = [&file, &fileKey, &type](FileData* other) -> bool
+	{
+		if(type.keyFunction == NULL)
+			return type.comparisonFunction(file, other);
+
+		SortKey otherKey;
+		otherKey.number = 0;
+		type.keyFunction(other, otherKey);
+		return compareSortKeys(fileKey, otherKey);
+	};
+
+	// a stable sort leaves file after the children equal to it, reversing it puts file before them
+	if(type.ascending)
+		it = std::partition_point(mChildren.begin(), mChildren.end(), [&sortsBefore](FileData* other) { return !sortsBefore(other); });
+	else
+		it = std::partition_point(mChildren.begin(), mChildren.end(), sortsBefore);
+
+	const size_t to = it - mChildren.begin();
+	mChildren.insert(it, file);
+	childrenChanged(false);
+
+	return to != from;
+}
+
 void FileData::sort(const SortType& type)
 {
-	sort(*type.comparisonFunction, type.ascending);
+	if(type.keyFunction != NULL)
+		sort(*type.keyFunction, type.ascending);
+	else
+		sort(*type.comparisonFunction, type.ascending);
 }
 
 void FileData::launchGame(Window* window)
@@ -212,6 +694,11 @@ void FileData::launchGame(Window* window)
 	//update last played time
 	boost::posix_time::ptime time = boost::posix_time::second_clock::universal_time();
 	gameToUpdate->metadata.setTime("lastplayed", time);
+
+	// a single line in the journal instead of rewriting the gamelist
+	if(!Settings::getInstance()->getBool("IgnoreGamelist"))
+		PlayStatsJournal::record(gameToUpdate);
+
 	CollectionSystemManager::get()->refreshCollectionSystems(gameToUpdate);
 }
 
@@ -224,6 +711,9 @@ CollectionFileData::CollectionFileData(FileData* file, SystemData* system)
 	mParent = NULL;
 	metadata = mSourceFileData->metadata;
 	mSystemName = mSourceFileData->getSystem()->getName();
+	mKey = getFullPath();
+
+	mSourceFileData->addCollectionEntry(this);
 }
 
 CollectionFileData::~CollectionFileData()
@@ -232,10 +722,12 @@ CollectionFileData::~CollectionFileData()
 	if(mParent)
 		mParent->removeChild(this);
 	mParent = NULL;
+
+	mSourceFileData->removeCollectionEntry(this);
 }
 
-std::string CollectionFileData::getKey() {
-	return getFullPath();
+const std::string& CollectionFileData::getKey() {
+	return mKey;
 }
 
 FileData* CollectionFileData::getSourceFileData()
@@ -262,7 +754,6 @@ const std::string& CollectionFileData::getName()
 
 // returns Sort Type based on a string description
 FileData::SortType getSortTypeFromString(std::string desc) {
-	std::vector<FileData::SortType> SortTypes = FileSorts::SortTypes;
 	// find it
 	for(unsigned int i = 0; i < FileSorts::SortTypes.size(); i++)
 	{
@@ -7,6 +7,8 @@
 #include "MetaData.h"
 
 class SystemData;
+class FileArena;
+class FileFilterIndex;
 struct SystemEnvironmentData;
 
 enum FileType
@@ -21,7 +23,8 @@ enum FileChangeType
 	FILE_ADDED,
 	FILE_METADATA_CHANGED,
 	FILE_REMOVED,
-	FILE_SORTED
+	FILE_SORTED,
+	FILE_MOVED // only this file changed its place among its siblings
 };
 
 // Used for loading/saving gamelist.xml.
@@ -33,11 +36,25 @@ class FileData
 {
 public:
 	FileData(FileType type, const boost::filesystem::path& path, SystemEnvironmentData* envData, SystemData* system);
+	// a node that only knows its own name, its path comes from the folder it's added to
+	FileData(FileType type, const std::string& name, SystemData* system);
 	virtual ~FileData();
 
+	// nodes of a game system live in its FileArena (new (arena) FileData(...)), the rest on the heap;
+	// delete works the same on both
+	static void* operator new(size_t size);
+	static void* operator new(size_t size, FileArena& arena);
+	static void operator delete(void* ptr, size_t size);
+	static void operator delete(void* ptr, FileArena& arena);
+
+	// Deletes this node and everything below it. Nodes aren't taken out of their parent or the filter index
+	// one by one, so this is only for trees that go away with their system.
+	void deleteTree();
+
 	virtual const std::string& getName();
 	inline FileType getType() const { return mType; }
-	inline const boost::filesystem::path& getPath() const { return mPath; }
+	boost::filesystem::path getPath() const; // built from the parent's path, prefer getFileName() where that's enough
+	void appendPath(std::string& out) const; // the same without building a new path, for loops over many nodes
 	inline FileData* getParent() const { return mParent; }
 	inline const std::unordered_map<std::string, FileData*>& getChildrenByFilename() const { return mChildrenByFilename; }
 	inline const std::vector<FileData*>& getChildren() const { return mChildren; }
@@ -53,16 +70,35 @@ public:
 	void addChild(FileData* file); // Error if mType != FOLDER
 	void removeChild(FileData* file); //Error if mType != FOLDER
 
+	// A collection's root folder can list games of other systems as they are, without copying them or becoming
+	// their parent; they keep their own parent and system. Such a folder only ever has linked children.
+	void linkChild(FileData* game);
+	void unlinkChild(FileData* game);
+	inline bool linksChildren() const { return mLinksChildren; }
+
+	// The folder that lists this in the views of system: the root of a collection of that system (or bundled in it)
+	// that links to this, otherwise the parent.
+	FileData* getListingFolder(const SystemData* system) const;
+
+	// the name shown in a list of system; a game linked there from another system is tagged with its own,
+	// like the entries of collections are
+	std::string getListName(const SystemData* system);
+
 	inline bool isPlaceHolder() { return mType == PLACEHOLDER; };
 
 	virtual inline void refreshMetadata() { return; };
 
-	virtual std::string getKey();
-	inline std::string getFullPath() { return getPath().string(); };
-	inline std::string getFileName() { return getPath().filename().string(); };
+	virtual const std::string& getKey();
+	inline std::string getFullPath() { std::string path; appendPath(path); return path; };
+	inline const std::string& getFileName() const { return mName; };
 	virtual FileData* getSourceFileData();
 	inline std::string getSystemName() const { return mSystemName; };
 
+	// the entries that show this game in collections, NULL if it's in none; kept by CollectionFileData and by
+	// linkChild(), for a collection that links to the game the entry is the collection's root folder
+	inline const std::vector<FileData*>* getCollectionEntries() const { return mCollectionEntries; }
+	FileData* getCollectionEntry(const SystemData* collection) const; // NULL if the collection doesn't show it
+
 	// Returns our best guess at the "real" name for this file (will attempt to perform MAME name translation)
 	std::string getDisplayName() const;
 
@@ -72,18 +108,39 @@ public:
 	void launchGame(Window* window);
 
 	typedef bool ComparisonFunction(const FileData* a, const FileData* b);
+
+	// what a file is sorted by, worked out once per sort instead of in every comparison;
+	// files are ordered by number first, then by text
+	struct SortKey
+	{
+		double number;
+		std::string text;
+	};
+	typedef void KeyFunction(const FileData* file, SortKey& key);
+
 	struct SortType
 	{
 		ComparisonFunction* comparisonFunction;
+		// gives the same order as comparisonFunction among games; for times and last played,
+		// comparisonFunction leaves folders unordered while the key puts them with unplayed games
+		KeyFunction* keyFunction;
 		bool ascending;
 		std::string description;
 
-		SortType(ComparisonFunction* sortFunction, bool sortAscending, const std::string & sortDescription)
-			: comparisonFunction(sortFunction), ascending(sortAscending), description(sortDescription) {}
+		SortType(ComparisonFunction* sortFunction, KeyFunction* sortKeyFunction, bool sortAscending, const std::string & sortDescription)
+			: comparisonFunction(sortFunction), keyFunction(sortKeyFunction), ascending(sortAscending), description(sortDescription) {}
 	};
 
 	void sort(ComparisonFunction& comparator, bool ascending = true);
+	void sort(KeyFunction& keyFunction, bool ascending = true);
 	void sort(const SortType& type);
+
+	// Moves file, one of our children, to where the sort we were last sorted by would put it, the others are still
+	// in that order. Saves sorting everything again after one child was added or changed. If we were never sorted,
+	// everything is sorted by defaultType. Returns true if anything moved.
+	bool sortChild(FileData* file, const SortType& defaultType);
+	// what we were last sorted by, defaultType if we never were
+	SortType getSortType(const SortType& defaultType) const;
 	MetaDataList metadata;
 
 protected:
@@ -93,12 +150,54 @@ protected:
 
 private:
 	FileType mType;
-	boost::filesystem::path mPath;
+	// a node below its parent only keeps its own name, anything else also keeps the full path it was created with
+	std::string mName;
+	boost::filesystem::path* mAbsolutePath;
+
+	FileData(FileType type, const std::string& name, SystemEnvironmentData* envData, SystemData* system, boost::filesystem::path* absolutePath);
+	bool isPathBelow(const std::string& path, const std::string& name) const;
 	SystemEnvironmentData* mEnvData;
 	SystemData* mSystem;
 	std::unordered_map<std::string,FileData*> mChildrenByFilename;
 	std::vector<FileData*> mChildren;
 	std::vector<FileData*> mFilteredChildren;
+	bool mDeletingTree;
+	bool mLinksChildren;
+
+	// what sort() last put the children in order by, sortChild() keeps to it; both NULL if never sorted
+	ComparisonFunction* mSortedByComparator;
+	KeyFunction* mSortedByKey;
+	bool mSortedAscending;
+	void setSortedBy(ComparisonFunction* comparator, KeyFunction* keyFunction, bool ascending);
+
+	// mFilteredChildren is kept until the children, the filters or any metadata change
+	unsigned int mChildrenGeneration; // also goes up when something further down is added, removed or has its metadata changed
+	FileFilterIndex* mFilteredIndex;
+	unsigned int mFilteredIndexGeneration;
+	unsigned int mFilteredChildrenGeneration;
+	void childrenChanged(bool below);
+	void metadataChanged(); // called by our MetaDataList
+	unsigned int mSystemGameIndex; // where a game is in its system's getGames()
+	unsigned int mFilterIndexId; // the game's id in its system's filter index
+	std::vector<FileData*>* mCollectionEntries;
+	void addCollectionEntry(FileData* entry);
+	void removeCollectionEntry(FileData* entry);
+
+	// the children in the order of each key sorted by so far, ascending; kept until children come or go,
+	// or until the sum of their metadata versions shows one of them changed
+	struct SortCache
+	{
+		KeyFunction* keyFunction;
+		unsigned long long metadataVersions;
+		std::vector<FileData*> children;
+	};
+	std::vector<SortCache> mSortCaches;
+	unsigned long long getChildrenMetadataVersions() const;
+
+	friend class SystemData;
+	friend class FileFilterIndex;
+	friend class CollectionFileData;
+	friend class MetaDataList;
 };
 
 class CollectionFileData : public FileData
@@ -109,8 +208,9 @@ public:
 	const std::string& getName();
 	void refreshMetadata();
 	FileData* getSourceFileData();
-	std::string getKey();
+	const std::string& getKey();
 private:
+	std::string mKey;
 	// needs to be updated when metadata changes
 	std::string mCollectionFileName;
 	bool mDirty;
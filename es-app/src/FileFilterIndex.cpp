@@ -1,11 +1,14 @@
 #include "FileFilterIndex.h"
+#include "SystemData.h"
 
 #define UNKNOWN_LABEL "UNKNOWN"
 #define INCLUDE_UNKNOWN false;
 
 FileFilterIndex::FileFilterIndex()
-	: filterByGenre(false), filterByPlayers(false), filterByPubDev(false), filterByRatings(false), filterByFavorites(false)
+	: filterByGenre(false), filterByPlayers(false), filterByPubDev(false), filterByRatings(false), filterByFavorites(false), mGeneration(0), mShowBitsValid(false), mShowBitsGeneration(0)
 {
+	mUnknownId = StringPool::getInstance()->intern(UNKNOWN_LABEL);
+
 	FilterDataDecl filterDecls[] = {
 		//type 				//allKeys 				//filteredBy 		//filteredKeys 				//primaryKey 	//hasSecondaryKey 	//secondaryKey 	//menuLabel
 		{ FAVORITES_FILTER, &favoritesIndexAllKeys, &filterByFavorites,	&favoritesIndexFilteredKeys,"favorite",		false,				"",				"FAVORITES"	},
@@ -30,6 +33,7 @@ std::vector<FilterDataDecl>& FileFilterIndex::getFilterDataDecls()
 
 void FileFilterIndex::importIndex(FileFilterIndex* indexToImport)
 {
+	mGeneration++;
 	struct IndexImportStructure
     {
       std::map<std::string, int>* destinationIndex;
@@ -65,6 +69,12 @@ void FileFilterIndex::importIndex(FileFilterIndex* indexToImport)
 void FileFilterIndex::resetIndex()
 {
 	clearAllFilters();
+	mIndexedGames.clear();
+	mFreeGameIds.clear();
+	mForeignGameIds.clear();
+	for(int i = 0; i <= FAVORITES_FILTER; i++)
+		mKeyBits[i].clear();
+	mShowBitsValid = false;
 	clearIndex(genreIndexAllKeys);
 	clearIndex(playersIndexAllKeys);
 	clearIndex(pubDevIndexAllKeys);
@@ -72,27 +82,30 @@ void FileFilterIndex::resetIndex()
 	clearIndex(favoritesIndexAllKeys);
 }
 
-std::string FileFilterIndex::getIndexableKey(FileData* game, FilterIndexType type, bool getSecondary)
+StringPool::Id FileFilterIndex::getTrimmedId(StringPool::Id id)
 {
-	std::string key = "";
+	// nearly every value is already trimmed, those don't need a copy
+	const std::string& str = StringPool::getInstance()->get(id);
+	if(str.empty() || (!isspace((unsigned char)str.front()) && !isspace((unsigned char)str.back())))
+		return id;
+
+	return StringPool::getInstance()->intern(boost::trim_copy(str));
+}
+
+StringPool::Id FileFilterIndex::getIndexableKey(FileData* game, FilterIndexType type, bool getSecondary)
+{
+	StringPool* pool = StringPool::getInstance();
+	StringPool::Id key = StringPool::EMPTY;
 	switch(type)
 	{
 		case GENRE_FILTER:
 		{
-			key = strToUpper(game->metadata.get("genre"));
-			boost::trim(key);
-			if (getSecondary && !key.empty()) {
-				std::istringstream f(key);
-				std::string newKey;
-				getline(f, newKey, '/');
-				if (!newKey.empty() && newKey != key)
-				{
-					key = newKey;
-				}
-				else
-				{
-					key = std::string();
-				}
+			key = getTrimmedId(pool->getUpperId(game->metadata.getStringId(META_GENRE)));
+			if (getSecondary && key != StringPool::EMPTY) {
+				// the part before the first '/', if there is one
+				const std::string& genre = pool->get(key);
+				size_t slash = genre.find('/');
+				key = (slash != std::string::npos && slash > 0) ? pool->intern(genre.substr(0, slash)) : StringPool::EMPTY;
 			}
 			break;
 		}
@@ -101,59 +114,238 @@ std::string FileFilterIndex::getIndexableKey(FileData* game, FilterIndexType typ
 			if (getSecondary)
 				break;
 
-			key = game->metadata.get("players");
+			key = game->metadata.getStringId(META_PLAYERS);
 			break;
 		}
 		case PUBDEV_FILTER:
 		{
-			key = strToUpper(game->metadata.get("publisher"));
-			boost::trim(key);
+			StringPool::Id publisher = getTrimmedId(pool->getUpperId(game->metadata.getStringId(META_PUBLISHER)));
 
-			if ((getSecondary && !key.empty()) || (!getSecondary && key.empty()))
-				key = strToUpper(game->metadata.get("developer"));
+			if ((getSecondary && publisher != StringPool::EMPTY) || (!getSecondary && publisher == StringPool::EMPTY))
+				key = pool->getUpperId(game->metadata.getStringId(META_DEVELOPER));
 			else
-				key = strToUpper(game->metadata.get("publisher"));
+				key = pool->getUpperId(game->metadata.getStringId(META_PUBLISHER));
 			break;
 		}
 		case RATINGS_FILTER:
 		{
-			int ratingNumber = 0;
 			if (!getSecondary)
 			{
-				std::string ratingString = game->metadata.get("rating");
-				if (!ratingString.empty()) {
-					try {
-						ratingNumber = boost::math::iround(std::stod(ratingString)*5);
-						if (ratingNumber < 0)
-							ratingNumber = 0;
-
-						key = std::to_string(ratingNumber) + " STARS";
-					}
-					catch (int e)
-					{
-						LOG(LogError) << "Error parsing Rating (invalid value, expected decimal): " << ratingString;
-					}
-				}
+				int ratingNumber = boost::math::iround(game->metadata.getFloat(META_RATING) * 5);
+				if (ratingNumber > 0)
+					key = pool->intern(std::to_string(ratingNumber) + " STARS");
 			}
 			break;
 		}
 		case FAVORITES_FILTER:
 		{
 			if (game->getType() != GAME)
-				return "FALSE";
-			key = strToUpper(game->metadata.get("favorite"));
+				return pool->intern("FALSE");
+			key = pool->getUpperId(game->metadata.getStringId(META_FAVORITE));
 			break;
 		}
 	}
-	boost::trim(key);
-	if (key.empty() || (type == RATINGS_FILTER && key == "0 STARS")) {
-		key = UNKNOWN_LABEL;
+	key = getTrimmedId(key);
+	if (key == StringPool::EMPTY) {
+		key = mUnknownId;
 	}
 	return key;
 }
 
+#define NO_GAME_ID ((unsigned int)-1)
+
+static void setBit(FileFilterIndex::Bitmap& bits, unsigned int bit)
+{
+	if(bits.size() <= bit / 64)
+		bits.resize(bit / 64 + 1, 0);
+	bits[bit / 64] |= 1ULL << (bit % 64);
+}
+
+static void clearBit(FileFilterIndex::Bitmap& bits, unsigned int bit)
+{
+	if(bits.size() > bit / 64)
+		bits[bit / 64] &= ~(1ULL << (bit % 64));
+}
+
+static bool testBit(const FileFilterIndex::Bitmap& bits, unsigned int bit)
+{
+	return bits.size() > bit / 64 && (bits[bit / 64] & (1ULL << (bit % 64))) != 0;
+}
+
+bool FileFilterIndex::getGameId(FileData* game, unsigned int& id)
+{
+	if(game->getSystem()->getIndex() == this)
+	{
+		id = game->mFilterIndexId;
+	}else{
+		auto it = mForeignGameIds.find(game);
+		id = (it != mForeignGameIds.end()) ? it->second : NO_GAME_ID;
+	}
+
+	// the id may be left over from before a reset
+	return id < mIndexedGames.size() && mIndexedGames[id].game == game;
+}
+
+void FileFilterIndex::indexGameKeys(FileData* game)
+{
+	// indexed again without being removed, the newer keys win
+	unindexGameKeys(game);
+
+	unsigned int id;
+	if(mFreeGameIds.empty())
+	{
+		id = mIndexedGames.size();
+		mIndexedGames.push_back(IndexedGame());
+	}else{
+		id = mFreeGameIds.back();
+		mFreeGameIds.pop_back();
+	}
+
+	IndexedGame& entry = mIndexedGames[id];
+	entry.game = game;
+	entry.version = game->metadata.getVersion();
+	for(auto it = filterDataDecl.begin(); it != filterDataDecl.end(); it++)
+	{
+		StringPool::Id primary = getIndexableKey(game, it->type, false);
+		StringPool::Id secondary = it->hasSecondaryKey ? getIndexableKey(game, it->type, true) : mUnknownId;
+		entry.keys[it->type][0] = primary;
+		entry.keys[it->type][1] = secondary;
+
+		setBit(mKeyBits[it->type][primary], id);
+		if(secondary != mUnknownId)
+			setBit(mKeyBits[it->type][secondary], id);
+	}
+
+	if(game->getSystem()->getIndex() == this)
+		game->mFilterIndexId = id;
+	else
+		mForeignGameIds[game] = id;
+}
+
+void FileFilterIndex::unindexGameKeys(FileData* game)
+{
+	unsigned int id;
+	if(!getGameId(game, id))
+		return;
+
+	// the keys it was indexed with, its metadata may have changed since
+	IndexedGame& entry = mIndexedGames[id];
+	for(auto it = filterDataDecl.begin(); it != filterDataDecl.end(); it++)
+	{
+		clearBit(mKeyBits[it->type][entry.keys[it->type][0]], id);
+		if(entry.keys[it->type][1] != mUnknownId)
+			clearBit(mKeyBits[it->type][entry.keys[it->type][1]], id);
+	}
+
+	entry.game = NULL;
+	mFreeGameIds.push_back(id);
+
+	if(game->getSystem()->getIndex() == this)
+		game->mFilterIndexId = NO_GAME_ID;
+	else
+		mForeignGameIds.erase(game);
+}
+
+// ORs the bits of the keys of each type, and ANDs the types
+void FileFilterIndex::matchKeyBits(const KeyIds& keys, Bitmap& out)
+{
+	const size_t words = (mIndexedGames.size() + 63) / 64;
+	bool first = true;
+	out.assign(words, 0);
+
+	for(auto it = keys.begin(); it != keys.end(); it++)
+	{
+		// any of the keys of the type will do
+		Bitmap typeBits(words, 0);
+		for(auto keyIt = it->second.begin(); keyIt != it->second.end(); keyIt++)
+		{
+			auto bitsIt = mKeyBits[it->first].find(*keyIt);
+			if(bitsIt == mKeyBits[it->first].end())
+				continue;
+
+			const Bitmap& bits = bitsIt->second;
+			for(size_t i = 0; i < words && i < bits.size(); i++)
+				typeBits[i] |= bits[i];
+		}
+
+		// and every type has to let the game through
+		if(first)
+		{
+			out.swap(typeBits);
+			first = false;
+		}else{
+			for(size_t i = 0; i < words; i++)
+				out[i] &= typeBits[i];
+		}
+	}
+}
+
+const FileFilterIndex::Bitmap& FileFilterIndex::getShowBits()
+{
+	if(mShowBitsValid && mShowBitsGeneration == mGeneration)
+		return mShowBits;
+
+	KeyIds keys;
+	for(auto it = filterDataDecl.begin(); it != filterDataDecl.end(); it++)
+	{
+		if(*(it->filteredByRef))
+			keys.push_back(std::make_pair(it->type, mFilteredKeyIds[it->type]));
+	}
+	matchKeyBits(keys, mShowBits);
+
+	mShowBitsValid = true;
+	mShowBitsGeneration = mGeneration;
+	return mShowBits;
+}
+
+// a key as the index stores it, upper case but for the number of players
+StringPool::Id FileFilterIndex::getKeyId(FilterIndexType type, const std::string& key)
+{
+	StringPool* pool = StringPool::getInstance();
+	StringPool::Id id = pool->intern(boost::trim_copy(key));
+	return (type == PLAYER_FILTER) ? id : pool->getUpperId(id);
+}
+
+bool FileFilterIndex::hasKey(FileData* game, FilterIndexType type, const std::string& key)
+{
+	StringPool::Id keyId = getKeyId(type, key);
+	if(getIndexableKey(game, type, false) == keyId)
+		return true;
+
+	for(auto it = filterDataDecl.begin(); it != filterDataDecl.end(); it++)
+	{
+		if(it->type == type)
+			return it->hasSecondaryKey && getIndexableKey(game, type, true) == keyId;
+	}
+	return false;
+}
+
+void FileFilterIndex::getCandidates(const std::vector<FileData*>& games, const std::map< FilterIndexType, std::vector<std::string> >& keys, std::vector<FileData*>& out)
+{
+	KeyIds keyIds;
+	for(auto it = keys.begin(); it != keys.end(); it++)
+	{
+		std::vector<StringPool::Id> ids;
+		for(auto keyIt = it->second.begin(); keyIt != it->second.end(); keyIt++)
+			ids.push_back(getKeyId(it->first, *keyIt));
+		keyIds.push_back(std::make_pair(it->first, ids));
+	}
+
+	Bitmap bits;
+	matchKeyBits(keyIds, bits);
+
+	for(auto it = games.begin(); it != games.end(); it++)
+	{
+		unsigned int id;
+		if(!getGameId(*it, id) || mIndexedGames[id].version != (*it)->metadata.getVersion() || testBit(bits, id))
+			out.push_back(*it);
+	}
+}
+
 void FileFilterIndex::addToIndex(FileData* game)
 {
+	mGeneration++;
+	indexGameKeys(game);
 	manageGenreEntryInIndex(game);
 	managePlayerEntryInIndex(game);
 	managePubDevEntryInIndex(game);
@@ -163,6 +355,13 @@ void FileFilterIndex::addToIndex(FileData* game)
 
 void FileFilterIndex::removeFromIndex(FileData* game)
 {
+	// taken out already, the counts must not go down twice
+	unsigned int id;
+	if(!getGameId(game, id))
+		return;
+
+	mGeneration++;
+	unindexGameKeys(game);
 	manageGenreEntryInIndex(game, true);
 	managePlayerEntryInIndex(game, true);
 	managePubDevEntryInIndex(game, true);
@@ -172,6 +371,7 @@ void FileFilterIndex::removeFromIndex(FileData* game)
 
 void FileFilterIndex::setFilter(FilterIndexType type, std::vector<std::string>* values)
 {
+	mGeneration++;
 	// test if it exists before setting
 	if(type == NONE)
 	{
@@ -185,10 +385,12 @@ void FileFilterIndex::setFilter(FilterIndexType type, std::vector<std::string>*
 				FilterDataDecl filterData = (*it);
 				*(filterData.filteredByRef) = values->size() > 0;
 				filterData.currentFilteredKeys->clear();
+				mFilteredKeyIds[type].clear();
 				for (std::vector<std::string>::iterator vit = values->begin(); vit != values->end(); ++vit ) {
 					// check if exists
 					if (filterData.allIndexKeys->find(*vit) != filterData.allIndexKeys->end()) {
 						filterData.currentFilteredKeys->push_back(std::string(*vit));
+						mFilteredKeyIds[type].push_back(StringPool::getInstance()->intern(*vit));
 					}
 				}
 			}
@@ -199,11 +401,13 @@ void FileFilterIndex::setFilter(FilterIndexType type, std::vector<std::string>*
 
 void FileFilterIndex::clearAllFilters()
 {
+	mGeneration++;
 	for (std::vector<FilterDataDecl>::iterator it = filterDataDecl.begin(); it != filterDataDecl.end(); ++it )
 	{
 		FilterDataDecl filterData = (*it);
 		*(filterData.filteredByRef) = false;
 		filterData.currentFilteredKeys->clear();
+		mFilteredKeyIds[filterData.type].clear();
 	}
 	return;
 }
@@ -237,10 +441,10 @@ bool FileFilterIndex::showFile(FileData* game)
 	// if folder, needs further inspection - i.e. see if folder contains at least one element
 	// that should be shown
 	if (game->getType() == FOLDER) {
-		std::vector<FileData*> children = game->getChildren();
+		const std::vector<FileData*>& children = game->getChildren();
 		// iterate through all of the children, until there's a match
 
-		for (std::vector<FileData*>::iterator it = children.begin(); it != children.end(); ++it ) {
+		for (std::vector<FileData*>::const_iterator it = children.begin(); it != children.end(); ++it ) {
 			if (showFile(*it))
 			{
 				return true;
@@ -249,6 +453,16 @@ bool FileFilterIndex::showFile(FileData* game)
 		return false;
 	}
 
+	// one bit test for games indexed here that haven't changed since
+	unsigned int id;
+	if (getGameId(game, id) && mIndexedGames[id].version == game->metadata.getVersion())
+		return testBit(getShowBits(), id);
+
+	return showFileByKeys(game);
+}
+
+bool FileFilterIndex::showFileByKeys(FileData* game)
+{
 	bool keepGoing = false;
 
 	for (std::vector<FilterDataDecl>::iterator it = filterDataDecl.begin(); it != filterDataDecl.end(); ++it ) {
@@ -256,8 +470,8 @@ bool FileFilterIndex::showFile(FileData* game)
 		if(*(filterData.filteredByRef))
 		{
 			// try to find a match
-			std::string key = getIndexableKey(game, filterData.type, false);
-			keepGoing = isKeyBeingFilteredBy(key, filterData.type);
+			StringPool::Id key = getIndexableKey(game, filterData.type, false);
+			keepGoing = isKeyIdBeingFilteredBy(key, filterData.type);
 
 			// if we didn't find a match, try for secondary keys - i.e. publisher and dev, or first genre
 			if (!keepGoing)
@@ -266,10 +480,10 @@ bool FileFilterIndex::showFile(FileData* game)
 				{
 					return false;
 				}
-				std::string secKey = getIndexableKey(game, filterData.type, true);
-				if (secKey != UNKNOWN_LABEL)
+				StringPool::Id secKey = getIndexableKey(game, filterData.type, true);
+				if (secKey != mUnknownId)
 				{
-					keepGoing = isKeyBeingFilteredBy(secKey, filterData.type);
+					keepGoing = isKeyIdBeingFilteredBy(secKey, filterData.type);
 				}
 			}
 			// if still nothing, then it's not a match
@@ -285,37 +499,25 @@ bool FileFilterIndex::showFile(FileData* game)
 
 bool FileFilterIndex::isKeyBeingFilteredBy(std::string key, FilterIndexType type)
 {
-	const FilterIndexType filterTypes[5] = { FAVORITES_FILTER, PLAYER_FILTER, RATINGS_FILTER, GENRE_FILTER, PUBDEV_FILTER };
-	std::vector<std::string> filterKeysList[5] = { favoritesIndexFilteredKeys, playersIndexFilteredKeys, ratingsIndexFilteredKeys, genreIndexFilteredKeys, pubDevIndexFilteredKeys };
-
-	for (int i = 0; i < 5; i++)
-	{
-		if (filterTypes[i] == type)
-		{
-			for (std::vector<std::string>::iterator it = filterKeysList[i].begin(); it != filterKeysList[i].end(); ++it )
-			{
-				if (key == (*it))
-				{
-					return true;
-				}
-			}
-			return false;
-		}
-	}
+	return isKeyIdBeingFilteredBy(StringPool::getInstance()->intern(key), type);
+}
 
-	return false;
+bool FileFilterIndex::isKeyIdBeingFilteredBy(StringPool::Id key, FilterIndexType type)
+{
+	const std::vector<StringPool::Id>& filteredKeys = mFilteredKeyIds[type];
+	return std::find(filteredKeys.begin(), filteredKeys.end(), key) != filteredKeys.end();
 }
 
 void FileFilterIndex::manageGenreEntryInIndex(FileData* game, bool remove)
 {
 
-	std::string key = getIndexableKey(game, GENRE_FILTER, false);
+	StringPool::Id key = getIndexableKey(game, GENRE_FILTER, false);
 
 	// flag for including unknowns
 	bool includeUnknown = INCLUDE_UNKNOWN;
 
 	// only add unknown in pubdev IF both dev and pub are empty
-	if (!includeUnknown && (key == UNKNOWN_LABEL || key == "BIOS")) {
+	if (!includeUnknown && (key == mUnknownId || StringPool::getInstance()->get(key) == "BIOS")) {
 		// no valid genre info found
 		return;
 	}
@@ -323,7 +525,7 @@ void FileFilterIndex::manageGenreEntryInIndex(FileData* game, bool remove)
 	manageIndexEntry(&genreIndexAllKeys, key, remove);
 
 	key = getIndexableKey(game, GENRE_FILTER, true);
-	if (!includeUnknown && key == UNKNOWN_LABEL)
+	if (!includeUnknown && key == mUnknownId)
 	{
 		manageIndexEntry(&genreIndexAllKeys, key, remove);
 	}
@@ -333,10 +535,10 @@ void FileFilterIndex::managePlayerEntryInIndex(FileData* game, bool remove)
 {
 	// flag for including unknowns
 	bool includeUnknown = INCLUDE_UNKNOWN;
-	std::string key = getIndexableKey(game, PLAYER_FILTER, false);
+	StringPool::Id key = getIndexableKey(game, PLAYER_FILTER, false);
 
 	// only add unknown in pubdev IF both dev and pub are empty
-	if (!includeUnknown && key == UNKNOWN_LABEL) {
+	if (!includeUnknown && key == mUnknownId) {
 		// no valid player info found
 		return;
 	}
@@ -346,18 +548,18 @@ void FileFilterIndex::managePlayerEntryInIndex(FileData* game, bool remove)
 
 void FileFilterIndex::managePubDevEntryInIndex(FileData* game, bool remove)
 {
-	std::string pub = getIndexableKey(game, PUBDEV_FILTER, false);
-	std::string dev = getIndexableKey(game, PUBDEV_FILTER, true);
+	StringPool::Id pub = getIndexableKey(game, PUBDEV_FILTER, false);
+	StringPool::Id dev = getIndexableKey(game, PUBDEV_FILTER, true);
 
 	// flag for including unknowns
 	bool includeUnknown = INCLUDE_UNKNOWN;
 	bool unknownPub = false;
 	bool unknownDev = false;
 
-	if (pub == UNKNOWN_LABEL) {
+	if (pub == mUnknownId) {
 		unknownPub = true;
 	}
-	if (dev == UNKNOWN_LABEL) {
+	if (dev == mUnknownId) {
 		unknownDev = true;
 	}
 
@@ -385,12 +587,12 @@ void FileFilterIndex::managePubDevEntryInIndex(FileData* game, bool remove)
 
 void FileFilterIndex::manageRatingsEntryInIndex(FileData* game, bool remove)
 {
-	std::string key = getIndexableKey(game, RATINGS_FILTER, false);
+	StringPool::Id key = getIndexableKey(game, RATINGS_FILTER, false);
 
 	// flag for including unknowns
 	bool includeUnknown = INCLUDE_UNKNOWN;
 
-	if (!includeUnknown && key == UNKNOWN_LABEL) {
+	if (!includeUnknown && key == mUnknownId) {
 		// no valid rating info found
 		return;
 	}
@@ -402,8 +604,8 @@ void FileFilterIndex::manageFavoritesEntryInIndex(FileData* game, bool remove)
 {
 	// flag for including unknowns
 	bool includeUnknown = INCLUDE_UNKNOWN;
-	std::string key = getIndexableKey(game, FAVORITES_FILTER, false);
-	if (!includeUnknown && key == UNKNOWN_LABEL) {
+	StringPool::Id key = getIndexableKey(game, FAVORITES_FILTER, false);
+	if (!includeUnknown && key == mUnknownId) {
 		// no valid favorites info found
 		return;
 	}
@@ -411,10 +613,11 @@ void FileFilterIndex::manageFavoritesEntryInIndex(FileData* game, bool remove)
 	manageIndexEntry(&favoritesIndexAllKeys, key, remove);
 }
 
-void FileFilterIndex::manageIndexEntry(std::map<std::string, int>* index, std::string key, bool remove) {
+void FileFilterIndex::manageIndexEntry(std::map<std::string, int>* index, StringPool::Id keyId, bool remove) {
 	bool includeUnknown = INCLUDE_UNKNOWN;
-	if (!includeUnknown && key == UNKNOWN_LABEL)
+	if (!includeUnknown && keyId == mUnknownId)
 		return;
+	const std::string& key = StringPool::getInstance()->get(keyId);
 	if (remove) {
 		// removing entry
 		if (index->find(key) == index->end())
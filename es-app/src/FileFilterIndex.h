@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include "FileData.h"
 #include "Log.h"
 #include <boost/math/special_functions/round.hpp>
@@ -8,6 +9,7 @@
 #include <sstream>
 #include <iostream>
 #include "Util.h"
+#include "StringPool.h"
 
 enum FilterIndexType
 {
@@ -34,6 +36,8 @@ struct FilterDataDecl
 class FileFilterIndex
 {
 public:
+	typedef std::vector<unsigned long long> Bitmap;
+
 	FileFilterIndex();
 	~FileFilterIndex();
 	void addToIndex(FileData* game);
@@ -48,9 +52,20 @@ public:
 
 	void importIndex(FileFilterIndex* indexToImport);
 	void resetIndex();
+
+	// changes whenever a game is indexed or the filters change, so results of showFile() can be kept until then
+	inline unsigned int getGeneration() const { return mGeneration; }
+
+	// Whether the game has key for type, matched the way the filters match it (primary or secondary key, case and spaces aside).
+	bool hasKey(FileData* game, FilterIndexType type, const std::string& key);
+	// Adds the games that have any of the keys of each type given, worked out from the key bitmaps like the filters are.
+	// Games that aren't indexed or changed since they were are added as well, so check every one of them with hasKey().
+	void getCandidates(const std::vector<FileData*>& games, const std::map< FilterIndexType, std::vector<std::string> >& keys, std::vector<FileData*>& out);
 private:
 	std::vector<FilterDataDecl> filterDataDecl;
-	std::string getIndexableKey(FileData* game, FilterIndexType type, bool getSecondary);
+	StringPool::Id getIndexableKey(FileData* game, FilterIndexType type, bool getSecondary);
+	StringPool::Id getTrimmedId(StringPool::Id id);
+	bool isKeyIdBeingFilteredBy(StringPool::Id key, FilterIndexType type);
 
 	void manageGenreEntryInIndex(FileData* game, bool remove = false);
 	void managePlayerEntryInIndex(FileData* game, bool remove = false);
@@ -58,10 +73,29 @@ private:
 	void manageRatingsEntryInIndex(FileData* game, bool remove = false);
 	void manageFavoritesEntryInIndex(FileData* game, bool remove = false);
 
-	void manageIndexEntry(std::map<std::string, int>* index, std::string key, bool remove);
+	void manageIndexEntry(std::map<std::string, int>* index, StringPool::Id key, bool remove);
 
 	void clearIndex(std::map<std::string, int> indexMap);
 
+	// Every indexed game gets a dense id, and each key of each filter type a bitmap of the games that have it,
+	// so the active filters come down to ORing and ANDing a few bitmaps.
+	struct IndexedGame
+	{
+		FileData* game;
+		unsigned int version; // of the game's metadata when it was indexed, its bits are only trusted while it's the same
+		StringPool::Id keys[FAVORITES_FILTER + 1][2]; // primary and secondary
+	};
+
+	typedef std::vector< std::pair< FilterIndexType, std::vector<StringPool::Id> > > KeyIds;
+
+	bool getGameId(FileData* game, unsigned int& id);
+	StringPool::Id getKeyId(FilterIndexType type, const std::string& key);
+	void matchKeyBits(const KeyIds& keys, Bitmap& out);
+	void indexGameKeys(FileData* game);
+	void unindexGameKeys(FileData* game);
+	const Bitmap& getShowBits();
+	bool showFileByKeys(FileData* game);
+
 	bool filterByGenre;
 	bool filterByPlayers;
 	bool filterByPubDev;
@@ -80,6 +114,19 @@ private:
 	std::vector<std::string> ratingsIndexFilteredKeys;
 	std::vector<std::string> favoritesIndexFilteredKeys;
 
+	// the filtered keys again, as pool ids so games can be checked with integer compares
+	std::vector<StringPool::Id> mFilteredKeyIds[FAVORITES_FILTER + 1];
+	StringPool::Id mUnknownId;
+	unsigned int mGeneration;
+
+	std::vector<IndexedGame> mIndexedGames;
+	std::vector<unsigned int> mFreeGameIds;
+	std::unordered_map<const FileData*, unsigned int> mForeignGameIds; // games of other systems, like collections in the bundle; a game's own index keeps its id in the game
+	std::unordered_map<StringPool::Id, Bitmap> mKeyBits[FAVORITES_FILTER + 1];
+	Bitmap mShowBits; // the games the active filters let through
+	bool mShowBitsValid;
+	unsigned int mShowBitsGeneration;
+
 	FileData* mRootFolder;
 
 };
\ No newline at end of file
@@ -1,41 +1,51 @@
 #include "FileSorts.h"
+#include <limits>
 
 namespace FileSorts
 {
 	const FileData::SortType typesArr[] = {
-		FileData::SortType(&compareName, true, "filename, ascending"),
-		FileData::SortType(&compareName, false, "filename, descending"),
+		FileData::SortType(&compareName, &nameKey, true, "filename, ascending"),
+		FileData::SortType(&compareName, &nameKey, false, "filename, descending"),
 
-		FileData::SortType(&compareRating, true, "rating, ascending"),
-		FileData::SortType(&compareRating, false, "rating, descending"),
+		FileData::SortType(&compareRating, &ratingKey, true, "rating, ascending"),
+		FileData::SortType(&compareRating, &ratingKey, false, "rating, descending"),
 
-		FileData::SortType(&compareTimesPlayed, true, "times played, ascending"),
-		FileData::SortType(&compareTimesPlayed, false, "times played, descending"),
+		FileData::SortType(&compareTimesPlayed, &timesPlayedKey, true, "times played, ascending"),
+		FileData::SortType(&compareTimesPlayed, &timesPlayedKey, false, "times played, descending"),
 
-		FileData::SortType(&compareLastPlayed, true, "last played, ascending"),
-		FileData::SortType(&compareLastPlayed, false, "last played, descending"),
+		FileData::SortType(&compareLastPlayed, &lastPlayedKey, true, "last played, ascending"),
+		FileData::SortType(&compareLastPlayed, &lastPlayedKey, false, "last played, descending"),
 
-		FileData::SortType(&compareNumPlayers, true, "number players, ascending"),
-		FileData::SortType(&compareNumPlayers, false, "number players, descending"),
+		FileData::SortType(&compareNumPlayers, &numPlayersKey, true, "number players, ascending"),
+		FileData::SortType(&compareNumPlayers, &numPlayersKey, false, "number players, descending"),
 
-		FileData::SortType(&compareReleaseDate, true, "release date, ascending"),
-		FileData::SortType(&compareReleaseDate, false, "release date, descending"),
+		FileData::SortType(&compareReleaseDate, &releaseDateKey, true, "release date, ascending"),
+		FileData::SortType(&compareReleaseDate, &releaseDateKey, false, "release date, descending"),
 
-		FileData::SortType(&compareGenre, true, "genre, ascending"),
-		FileData::SortType(&compareGenre, false, "genre, descending"),
+		FileData::SortType(&compareGenre, &genreKey, true, "genre, ascending"),
+		FileData::SortType(&compareGenre, &genreKey, false, "genre, descending"),
 
-		FileData::SortType(&compareDeveloper, true, "developer, ascending"),
-		FileData::SortType(&compareDeveloper, false, "developer, descending"),
+		FileData::SortType(&compareDeveloper, &developerKey, true, "developer, ascending"),
+		FileData::SortType(&compareDeveloper, &developerKey, false, "developer, descending"),
 
-		FileData::SortType(&comparePublisher, true, "publisher, ascending"),
-		FileData::SortType(&comparePublisher, false, "publisher, descending"),
+		FileData::SortType(&comparePublisher, &publisherKey, true, "publisher, ascending"),
+		FileData::SortType(&comparePublisher, &publisherKey, false, "publisher, descending"),
 
-		FileData::SortType(&compareSystem, true, "system, ascending"),
-		FileData::SortType(&compareSystem, false, "system, descending")
+		FileData::SortType(&compareSystem, &systemKey, true, "system, ascending"),
+		FileData::SortType(&compareSystem, &systemKey, false, "system, descending")
 	};
 
 	const std::vector<FileData::SortType> SortTypes(typesArr, typesArr + sizeof(typesArr)/sizeof(typesArr[0]));
 
+	// case insensitive compare of two pooled strings, games with the same value don't need the strings at all
+	static bool compareUpperIds(StringPool::Id id1, StringPool::Id id2)
+	{
+		StringPool* pool = StringPool::getInstance();
+		id1 = pool->getUpperId(id1);
+		id2 = pool->getUpperId(id2);
+		return id1 != id2 && pool->get(id1).compare(pool->get(id2)) < 0;
+	}
+
 	//returns if file1 should come before file2
 	bool compareName(const FileData* file1, const FileData* file2)
 	{
@@ -88,29 +98,17 @@ namespace FileSorts
 
 	bool compareGenre(const FileData* file1, const FileData* file2)
 	{
-		std::string genre1 = file1->metadata.get("genre");
-		std::string genre2 = file2->metadata.get("genre");
-		transform(genre1.begin(), genre1.end(), genre1.begin(), ::toupper);
-		transform(genre2.begin(), genre2.end(), genre2.begin(), ::toupper);
-		return genre1.compare(genre2) < 0;
+		return compareUpperIds(file1->metadata.getStringId(META_GENRE), file2->metadata.getStringId(META_GENRE));
 	}
 
 	bool compareDeveloper(const FileData* file1, const FileData* file2)
 	{
-		std::string developer1 = file1->metadata.get("developer");
-		std::string developer2 = file2->metadata.get("developer");
-		transform(developer1.begin(), developer1.end(), developer1.begin(), ::toupper);
-		transform(developer2.begin(), developer2.end(), developer2.begin(), ::toupper);
-		return developer1.compare(developer2) < 0;
+		return compareUpperIds(file1->metadata.getStringId(META_DEVELOPER), file2->metadata.getStringId(META_DEVELOPER));
 	}
 
 	bool comparePublisher(const FileData* file1, const FileData* file2)
 	{
-		std::string publisher1 = file1->metadata.get("publisher");
-		std::string publisher2 = file2->metadata.get("publisher");
-		transform(publisher1.begin(), publisher1.end(), publisher1.begin(), ::toupper);
-		transform(publisher2.begin(), publisher2.end(), publisher2.begin(), ::toupper);
-		return publisher1.compare(publisher2) < 0;
+		return compareUpperIds(file1->metadata.getStringId(META_PUBLISHER), file2->metadata.getStringId(META_PUBLISHER));
 	}
 
 	bool compareSystem(const FileData* file1, const FileData* file2)
@@ -121,4 +119,78 @@ namespace FileSorts
 		transform(system2.begin(), system2.end(), system2.begin(), ::toupper);
 		return system1.compare(system2) < 0;
 	}
+
+	// sort keys, giving the same order as the comparisons above without working anything out twice
+
+	static void upperKey(const std::string& str, FileData::SortKey& key)
+	{
+		key.text = str;
+		transform(key.text.begin(), key.text.end(), key.text.begin(), ::toupper);
+	}
+
+	static void pooledKey(StringPool::Id id, FileData::SortKey& key)
+	{
+		StringPool* pool = StringPool::getInstance();
+		key.text = pool->get(pool->getUpperId(id));
+	}
+
+	// seconds since 1970, anything that isn't a date comes first
+	static double timeKey(const boost::posix_time::ptime& time)
+	{
+		if(time.is_special())
+			return -std::numeric_limits<double>::max();
+
+		return (double)(time - boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1))).total_seconds();
+	}
+
+	void nameKey(const FileData* file, FileData::SortKey& key)
+	{
+		upperKey(file->metadata.getString(META_NAME), key);
+	}
+
+	void ratingKey(const FileData* file, FileData::SortKey& key)
+	{
+		key.number = file->metadata.getFloat(META_RATING);
+	}
+
+	// folders have no play statistics, they go with the games never played
+	void timesPlayedKey(const FileData* file, FileData::SortKey& key)
+	{
+		key.number = (file->metadata.getType() == GAME_METADATA) ? file->metadata.getInt(META_PLAYCOUNT) : 0;
+	}
+
+	void lastPlayedKey(const FileData* file, FileData::SortKey& key)
+	{
+		key.number = (file->metadata.getType() == GAME_METADATA) ? timeKey(file->metadata.getTime(META_LASTPLAYED)) : timeKey(boost::posix_time::not_a_date_time);
+	}
+
+	void numPlayersKey(const FileData* file, FileData::SortKey& key)
+	{
+		key.number = file->metadata.getInt(META_PLAYERS);
+	}
+
+	void releaseDateKey(const FileData* file, FileData::SortKey& key)
+	{
+		key.number = timeKey(file->metadata.getTime(META_RELEASEDATE));
+	}
+
+	void genreKey(const FileData* file, FileData::SortKey& key)
+	{
+		pooledKey(file->metadata.getStringId(META_GENRE), key);
+	}
+
+	void developerKey(const FileData* file, FileData::SortKey& key)
+	{
+		pooledKey(file->metadata.getStringId(META_DEVELOPER), key);
+	}
+
+	void publisherKey(const FileData* file, FileData::SortKey& key)
+	{
+		pooledKey(file->metadata.getStringId(META_PUBLISHER), key);
+	}
+
+	void systemKey(const FileData* file, FileData::SortKey& key)
+	{
+		upperKey(file->getSystemName(), key);
+	}
 };
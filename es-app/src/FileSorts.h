@@ -17,5 +17,16 @@ namespace FileSorts
 	bool comparePublisher(const FileData* file1, const FileData* file2);
 	bool compareSystem(const FileData* file1, const FileData* file2);
 
+	void nameKey(const FileData* file, FileData::SortKey& key);
+	void ratingKey(const FileData* file, FileData::SortKey& key);
+	void timesPlayedKey(const FileData* file, FileData::SortKey& key);
+	void lastPlayedKey(const FileData* file, FileData::SortKey& key);
+	void numPlayersKey(const FileData* file, FileData::SortKey& key);
+	void releaseDateKey(const FileData* file, FileData::SortKey& key);
+	void genreKey(const FileData* file, FileData::SortKey& key);
+	void developerKey(const FileData* file, FileData::SortKey& key);
+	void publisherKey(const FileData* file, FileData::SortKey& key);
+	void systemKey(const FileData* file, FileData::SortKey& key);
+
 	extern const std::vector<FileData::SortType> SortTypes;
 };
@@ -5,6 +5,20 @@
 #include "Log.h"
 #include "Settings.h"
 #include "Util.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <memory>
+#include "GamelistSnapshot.h"
+#include "GamelistReader.h"
+#include "PlayStatsJournal.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace fs = boost::filesystem;
 
@@ -54,7 +68,7 @@ FileData* findOrCreateFile(SystemData* system, const boost::filesystem::path& pa
 				return NULL;
 			}
 
-			FileData* file = new FileData(type, path, system->getSystemEnvData(), system);
+			FileData* file = new (system->getFileArena()) FileData(type, key, system);
 			treeNode->addChild(file);
 			return file;
 		}
@@ -70,7 +84,7 @@ FileData* findOrCreateFile(SystemData* system, const boost::filesystem::path& pa
 			}
 
 			// create missing folder
-			FileData* folder = new FileData(FOLDER, treeNode->getPath().stem() / *path_it, system->getSystemEnvData(), system);
+			FileData* folder = new (system->getFileArena()) FileData(FOLDER, key, system);
 			treeNode->addChild(folder);
 			treeNode = folder;
 		}
@@ -81,6 +95,40 @@ FileData* findOrCreateFile(SystemData* system, const boost::filesystem::path& pa
 	return NULL;
 }
 
+// adds one <game> or <folder> entry to the system, for both the XML and the snapshot loader
+static void addGamelistEntry(SystemData* system, FileType type, const fs::path& path, const MetaDataList& metadata, bool trustGamelist)
+{
+	if(!trustGamelist && !boost::filesystem::exists(path))
+	{
+		LOG(LogWarning) << "File \"" << path << "\" does not exist! Ignoring.";
+		return;
+	}
+
+	FileData* file = findOrCreateFile(system, path, type, trustGamelist);
+	if(!file)
+	{
+		LOG(LogError) << "Error finding/creating FileData for \"" << path << "\", skipping.";
+		return;
+	}
+
+	//load the metadata
+	std::string defaultName = file->metadata.get("name");
+	file->metadata = metadata;
+
+	//make sure name gets set if one didn't exist
+	if(file->metadata.get("name").empty())
+		file->metadata.set("name", defaultName);
+
+	file->metadata.resetChangedFlag();
+
+	// index if it's a game!
+	if(type == GAME)
+	{
+		FileFilterIndex* index = system->getIndex();
+		index->addToIndex(file);
+	}
+}
+
 void parseGamelist(SystemData* system)
 {
 	bool trustGamelist = Settings::getInstance()->getBool("ParseGamelistOnly");
@@ -89,19 +137,32 @@ void parseGamelist(SystemData* system)
 	if(!boost::filesystem::exists(xmlpath))
 		return;
 
-	LOG(LogInfo) << "Parsing XML file \"" << xmlpath << "\"...";
+	auto startTime = std::chrono::steady_clock::now();
 
-	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(xmlpath.c_str());
+	// only made when it's used, checking it against the XML may mean reading the whole file
+	bool useSnapshot = Settings::getInstance()->getBool("GamelistSnapshots");
+	std::unique_ptr<GamelistSnapshot> snapshot;
+	if(useSnapshot)
+		snapshot.reset(new GamelistSnapshot(system, xmlpath));
+	if(useSnapshot && snapshot->load([system, trustGamelist](FileType type, const fs::path& path, const MetaDataList& metadata)
+		{ addGamelistEntry(system, type, path, metadata, trustGamelist); }))
+	{
+		LOG(LogInfo) << "Loaded gamelist snapshot for \"" << xmlpath << "\" in "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << "ms";
+		return;
+	}
+
+	LOG(LogInfo) << "Parsing XML file \"" << xmlpath << "\"...";
 
-	if(!result)
+	// entries are read and added one at a time, the document is never held in memory as a whole
+	GamelistReader reader(xmlpath, false);
+	if(reader.hasError())
 	{
-		LOG(LogError) << "Error parsing XML file \"" << xmlpath << "\"!\n	" << result.description();
+		LOG(LogError) << "Error parsing XML file \"" << xmlpath << "\"!\n	" << reader.getError();
 		return;
 	}
 
-	pugi::xml_node root = doc.child("gameList");
-	if(!root)
+	if(reader.getRootName() != "gameList")
 	{
 		LOG(LogError) << "Could not find <gameList> node in gamelist \"" << xmlpath << "\"!";
 		return;
@@ -109,48 +170,53 @@ void parseGamelist(SystemData* system)
 
 	fs::path relativeTo = system->getStartPath();
 
-	const char* tagList[2] = { "game", "folder" };
-	FileType typeList[2] = { GAME, FOLDER };
-	for(int i = 0; i < 2; i++)
+	// folders are only found once the games inside them have created them, so they're added last
+	std::vector< std::pair<fs::path, MetaDataList> > folders;
+
+	GamelistReader::Entry entry;
+	while(reader.next(entry))
 	{
-		const char* tag = tagList[i];
-		FileType type = typeList[i];
-		for(pugi::xml_node fileNode = root.child(tag); fileNode; fileNode = fileNode.next_sibling(tag))
-		{
-			fs::path path = resolvePath(fileNode.child("path").text().get(), relativeTo, false);
+		bool isFolder = (entry.tag == "folder");
+		if(!isFolder && entry.tag != "game")
+			continue;
 
-			if(!trustGamelist && !boost::filesystem::exists(path))
-			{
-				LOG(LogWarning) << "File \"" << path << "\" does not exist! Ignoring.";
-				continue;
-			}
+		auto pathValue = entry.values.find("path");
+		fs::path path = resolvePath(pathValue != entry.values.end() ? pathValue->second : "", relativeTo, false);
+		MetaDataList metadata = MetaDataList::createFromValues(GAME_METADATA, entry.values, relativeTo);
 
-			FileData* file = findOrCreateFile(system, path, type, trustGamelist);
-			if(!file)
-			{
-				LOG(LogError) << "Error finding/creating FileData for \"" << path << "\", skipping.";
-				continue;
-			}
+		if(isFolder)
+		{
+			folders.push_back(std::make_pair(path, metadata));
+			continue;
+		}
 
-			//load the metadata
-			std::string defaultName = file->metadata.get("name");
-			file->metadata = MetaDataList::createFromXML(GAME_METADATA, fileNode, relativeTo);
+		// the snapshot keeps every entry, whether the file exists is checked again when it's loaded
+		if(useSnapshot)
+			snapshot->add(GAME, path, metadata);
 
-			//make sure name gets set if one didn't exist
-			if(file->metadata.get("name").empty())
-				file->metadata.set("name", defaultName);
+		addGamelistEntry(system, GAME, path, metadata, trustGamelist);
+	}
 
-			file->metadata.resetChangedFlag();
+	if(reader.hasError())
+	{
+		// what was read up to here stays, but it's not worth a snapshot
+		LOG(LogError) << "Error parsing XML file \"" << xmlpath << "\"!\n	" << reader.getError();
+		return;
+	}
 
-			// index if it's a game!
-			if(type == GAME)
-			{
-				FileFilterIndex* index = system->getIndex();
-				index->addToIndex(file);
-			}
+	for(auto it = folders.begin(); it != folders.end(); it++)
+	{
+		if(useSnapshot)
+			snapshot->add(FOLDER, it->first, it->second);
 
-		}
+		addGamelistEntry(system, FOLDER, it->first, it->second, trustGamelist);
 	}
+
+	if(useSnapshot)
+		snapshot->save();
+
+	LOG(LogInfo) << "Parsed \"" << xmlpath << "\" in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << "ms";
 }
 
 void addFileDataNode(pugi::xml_node& parent, const FileData* file, const char* tag, SystemData* system)
@@ -176,105 +242,225 @@ void addFileDataNode(pugi::xml_node& parent, const FileData* file, const char* t
 	}
 }
 
-void updateGamelist(SystemData* system)
+// the node addFileDataNode would add for file as text, empty if there's nothing worth writing
+static std::string printFileDataNode(const FileData* file, const char* tag, SystemData* system)
 {
-	//We do this by reading the XML again, adding changes and then writing it back,
-	//because there might be information missing in our systemdata which would then miss in the new XML.
-	//We have the complete information for every game though, so we can simply remove a game
-	//we already have in the system from the XML, and then add it back from its GameData information...
+	pugi::xml_document doc;
+	addFileDataNode(doc, file, tag, system);
 
-	if(Settings::getInstance()->getBool("IgnoreGamelist"))
-		return;
+	std::ostringstream out;
+	pugi::xml_node node = doc.first_child();
+	if(node)
+		node.print(out, "\t", pugi::format_default, pugi::encoding_auto, 1);
+	return out.str();
+}
 
-	pugi::xml_document doc;
-	pugi::xml_node root;
-	std::string xmlReadPath = system->getGamelistPath(false);
+bool prepareGamelistUpdate(SystemData* system, GamelistUpdate& update)
+{
+	if(Settings::getInstance()->getBool("IgnoreGamelist"))
+		return false;
 
-	if(boost::filesystem::exists(xmlReadPath))
+	FileData* rootFolder = system->getRootFolder();
+	if(rootFolder == nullptr)
 	{
-		//parse an existing file first
-		pugi::xml_parse_result result = doc.load_file(xmlReadPath.c_str());
+		LOG(LogError) << "Found no root folder for system \"" << system->getName() << "\"!";
+		return false;
+	}
 
-		if(!result)
-		{
-			LOG(LogError) << "Error parsing XML file \"" << xmlReadPath << "\"!\n	" << result.description();
-			return;
-		}
+	//get only files, no folders
+	std::vector<FileData*> files = rootFolder->getFilesRecursive(GAME | FOLDER);
 
-		root = doc.child("gameList");
-		if(!root)
+	// only files that have metadata and changed it need to be written, if there are none we don't even read the file
+	update.changed.clear();
+	update.ourPaths.clear();
+	std::string path;
+	for(std::vector<FileData*>::const_iterator fit = files.cbegin(); fit != files.cend(); ++fit)
+	{
+		// paths are built from the tree, so only once per file
+		path.clear();
+		(*fit)->appendPath(path);
+		update.ourPaths.insert(path);
+
+		if(!(*fit)->metadata.isDefault() && (*fit)->metadata.wasChanged())
 		{
-			LOG(LogError) << "Could not find <gameList> node in gamelist \"" << xmlReadPath << "\"!";
-			return;
+			GamelistUpdate::Entry entry;
+			entry.path = path;
+			entry.isGame = ((*fit)->getType() == GAME);
+			entry.xml = printFileDataNode(*fit, entry.isGame ? "game" : "folder", system);
+			update.changed.push_back(entry);
 		}
-	}else{
-		//set up an empty gamelist to append to
-		root = doc.append_child("gameList");
 	}
 
+	if(update.changed.empty())
+		return false;
 
-	//now we have all the information from the XML. now iterate through all our games and add information from there
-	FileData* rootFolder = system->getRootFolder();
-	if (rootFolder != nullptr)
+	update.systemName = system->getName();
+	update.startPath = system->getStartPath();
+	update.readPath = system->getGamelistPath(false);
+	update.writePath = system->getGamelistPath(true);
+
+	// every journaled statistic is in the changes too, so the journal can go once they're written
+	update.journalPath = PlayStatsJournal::getPath(system);
+	update.journalSize = PlayStatsJournal::getSize(update.journalPath);
+	return true;
+}
+
+// makes sure what was written to path is on the disk, not just in the page cache
+static bool syncPath(const std::string& path)
+{
+#ifndef WIN32
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	bool synced = (fsync(fd) == 0);
+	close(fd);
+	return synced;
+#else
+	return true;
+#endif
+}
+
+bool writeGamelistUpdate(const GamelistUpdate& update)
+{
+	//We do this by reading the XML again, adding changes and then writing it back,
+	//because there might be information missing in our systemdata which would then miss in the new XML.
+	//The gamelist is streamed from the old file to the new one, entries we changed are swapped in on the way
+	//and everything else is copied through untouched, so only one entry is ever in memory.
+
+	//make sure the folders leading up to this path exist (or the write will fail)
+	boost::filesystem::path xmlWritePath(update.writePath);
+	boost::filesystem::create_directories(xmlWritePath.parent_path());
+
+	// written next to it, synced and renamed, so a crash or power cut leaves either the old or the new file
+	std::string tempPath = update.writePath + ".tmp";
+	std::ofstream out(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out.is_open())
 	{
-		int numUpdated = 0;
+		LOG(LogError) << "Error saving gamelist.xml to \"" << xmlWritePath << "\" (for system " << update.systemName << ")!";
+		return false;
+	}
 
-		//get only files, no folders
-		std::vector<FileData*> files = rootFolder->getFilesRecursive(GAME | FOLDER);
-		//iterate through all files, checking if they're already in the XML
-		for(std::vector<FileData*>::const_iterator fit = files.cbegin(); fit != files.cend(); ++fit)
-		{
-			const char* tag = ((*fit)->getType() == GAME) ? "game" : "folder";
+	out << "<?xml version=\"1.0\"?>\n<gameList>\n";
 
-			// check if current file has metadata, if no, skip it as it wont be in the gamelist anyway.
-			if ((*fit)->metadata.isDefault()) {
-				continue;
-			}
+	std::unordered_map<std::string, const GamelistUpdate::Entry*> changedByPath;
+	for(auto it = update.changed.cbegin(); it != update.changed.cend(); ++it)
+		changedByPath.insert(std::make_pair(it->path, &(*it)));
+
+	std::unordered_set<const GamelistUpdate::Entry*> written;
 
-			// do not touch if it wasn't changed anyway
-			if (!(*fit)->metadata.wasChanged())
-				continue;
+	if(boost::filesystem::exists(update.readPath))
+	{
+		GamelistReader reader(update.readPath, true);
+		if(!reader.hasError() && reader.getRootName() != "gameList")
+		{
+			LOG(LogError) << "Could not find <gameList> node in gamelist \"" << update.readPath << "\"!";
+			out.close();
+			boost::filesystem::remove(tempPath);
+			return false;
+		}
 
-			// check if the file already exists in the XML
-			// if it does, remove it before adding
-			for(pugi::xml_node fileNode = root.child(tag); fileNode; fileNode = fileNode.next_sibling(tag))
+		// only built once a path we don't know shows up, this is the only place that touches the filesystem
+		std::unordered_map<std::string, const GamelistUpdate::Entry*> changedByCanonicalPath;
+		bool canonicalIndexed = false;
+
+		GamelistReader::Entry entry;
+		while(reader.next(entry))
+		{
+			// check if the file already exists in the XML, if it does, it's replaced where it is
+			const GamelistUpdate::Entry* changed = NULL;
+			if(entry.tag == "game" || entry.tag == "folder")
 			{
-				pugi::xml_node pathNode = fileNode.child("path");
-				if(!pathNode)
+				auto pathValue = entry.values.find("path");
+				if(pathValue == entry.values.end())
 				{
-					LOG(LogError) << "<" << tag << "> node contains no <path> child!";
-					continue;
+					LOG(LogError) << "<" << entry.tag << "> node contains no <path> child!";
+				}else{
+					std::string nodePath = resolvePath(pathValue->second, update.startPath, true).generic_string();
+					auto found = changedByPath.find(nodePath);
+					if(found != changedByPath.end())
+					{
+						changed = found->second;
+					}else if(update.ourPaths.find(nodePath) == update.ourPaths.end())
+					{
+						// a path we don't know may still point to one of our files through a link
+						if(!canonicalIndexed)
+						{
+							for(auto it = update.changed.cbegin(); it != update.changed.cend(); ++it)
+							{
+								boost::system::error_code ec;
+								fs::path canonical = fs::canonical(it->path, ec);
+								if(!ec)
+									changedByCanonicalPath.insert(std::make_pair(canonical.generic_string(), &(*it)));
+							}
+							canonicalIndexed = true;
+						}
+
+						boost::system::error_code ec;
+						fs::path canonical = fs::canonical(nodePath, ec);
+						auto alias = ec ? changedByCanonicalPath.end() : changedByCanonicalPath.find(canonical.generic_string());
+						if(alias != changedByCanonicalPath.end() && written.find(alias->second) == written.end())
+							changed = alias->second;
+					}
 				}
+			}
 
-				fs::path nodePath = resolvePath(pathNode.text().get(), system->getStartPath(), true);
-				fs::path gamePath((*fit)->getPath());
-				if(nodePath == gamePath || (fs::exists(nodePath) && fs::exists(gamePath) && fs::equivalent(nodePath, gamePath)))
-				{
-					// found it
-					root.remove_child(fileNode);
-					break;
-				}
+			if(changed != NULL && entry.tag == (changed->isGame ? "game" : "folder"))
+			{
+				out << changed->xml;
+				written.insert(changed);
+			}else{
+				out << "\t" << entry.raw << "\n";
 			}
+		}
 
-			// it was either removed or never existed to begin with; either way, we can add it now
-			addFileDataNode(root, *fit, tag, system);
-			++numUpdated;
+		if(reader.hasError())
+		{
+			LOG(LogError) << "Error parsing XML file \"" << update.readPath << "\"!\n	" << reader.getError();
+			out.close();
+			boost::filesystem::remove(tempPath);
+			return false;
 		}
+	}
 
-		//now write the file
+	// whatever wasn't in the XML yet is added at the end
+	for(auto it = update.changed.cbegin(); it != update.changed.cend(); ++it)
+	{
+		if(written.find(&(*it)) == written.end())
+			out << it->xml;
+	}
 
-		if (numUpdated > 0) {
-			//make sure the folders leading up to this path exist (or the write will fail)
-			boost::filesystem::path xmlWritePath(system->getGamelistPath(true));
-			boost::filesystem::create_directories(xmlWritePath.parent_path());
+	out << "</gameList>\n";
+	out.close();
 
-			LOG(LogInfo) << "Added/Updated " << numUpdated << " entities in '" << xmlReadPath << "'";
+	boost::system::error_code ec;
+	if(out.fail() || !syncPath(tempPath))
+	{
+		LOG(LogError) << "Error saving gamelist.xml to \"" << xmlWritePath << "\" (for system " << update.systemName << ")!";
+		fs::remove(tempPath, ec);
+		return false;
+	}
 
-			if (!doc.save_file(xmlWritePath.c_str())) {
-				LOG(LogError) << "Error saving gamelist.xml to \"" << xmlWritePath << "\" (for system " << system->getName() << ")!";
-			}
-		}
-	}else{
-		LOG(LogError) << "Found no root folder for system \"" << system->getName() << "\"!";
+	fs::rename(tempPath, xmlWritePath, ec);
+	if(ec)
+	{
+		LOG(LogError) << "Error saving gamelist.xml to \"" << xmlWritePath << "\" (for system " << update.systemName << ")! " << ec.message();
+		fs::remove(tempPath, ec);
+		return false;
 	}
+
+	// the rename itself is only durable once the folder is synced
+	syncPath(xmlWritePath.parent_path().generic_string());
+
+	PlayStatsJournal::discard(update.journalPath, update.journalSize);
+
+	LOG(LogInfo) << "Added/Updated " << update.changed.size() << " entities in '" << update.writePath << "'";
+	return true;
+}
+
+void updateGamelist(SystemData* system)
+{
+	GamelistUpdate update;
+	if(prepareGamelistUpdate(system, update))
+		writeGamelistUpdate(update);
 }
@@ -1,9 +1,41 @@
 #pragma once
 
+#include <string>
+#include <vector>
+#include <unordered_set>
+
 class SystemData;
 
+// Everything needed to write one system's gamelist.xml. It's taken from the system on the main thread,
+// so the write itself can happen on any thread, even after the system is gone.
+struct GamelistUpdate
+{
+	struct Entry
+	{
+		std::string path;
+		bool isGame;
+		std::string xml; // the printed node, empty if there's nothing worth keeping
+	};
+
+	std::string systemName;
+	std::string startPath;
+	std::string readPath;
+	std::string writePath;
+	std::unordered_set<std::string> ourPaths; // every file in the system, changed or not
+	std::vector<Entry> changed;
+
+	std::string journalPath; // the play statistics journal this write takes in
+	long long journalSize; // its size when the changes were taken, -1 if there was none
+};
+
 // Loads gamelist.xml data into a SystemData.
 void parseGamelist(SystemData* system);
 
-// Writes currently loaded metadata for a SystemData to gamelist.xml.
+// Collects the metadata changes of a SystemData. Returns false if there's nothing to write.
+bool prepareGamelistUpdate(SystemData* system, GamelistUpdate& update);
+
+// Merges collected changes into gamelist.xml, replacing it atomically. Safe to call from any thread.
+bool writeGamelistUpdate(const GamelistUpdate& update);
+
+// Writes currently loaded metadata for a SystemData to gamelist.xml, right away.
 void updateGamelist(SystemData* system);
@@ -0,0 +1,421 @@
+#include "GamelistReader.h"
+#include "pugixml/src/pugixml.hpp"
+#include "Log.h"
+#include <boost/algorithm/string/trim.hpp>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+
+// how much of the file is read at a time
+#define GAMELIST_CHUNK_SIZE (64 * 1024)
+
+GamelistReader::GamelistReader(const std::string& path, bool keepRaw) : mPos(0), mKeepRaw(keepRaw), mRaw(NULL), mReadWhole(false), mDone(false)
+{
+	mFile.open(path.c_str(), std::ios::in | std::ios::binary);
+	if(!mFile.is_open())
+	{
+		fail("could not open file");
+		return;
+	}
+
+	// a UTF-8 byte order mark says nothing we don't assume anyway
+	skipIf("\xEF\xBB\xBF");
+
+	// UTF-16, with a byte order mark or starting with "<" and a zero byte, isn't something we decode;
+	// pugixml is, so those files are read whole by it like they used to be
+	if(fill(2))
+	{
+		const unsigned char first = mBuffer[mPos];
+		const unsigned char second = mBuffer[mPos + 1];
+		if((first == 0xFF && second == 0xFE) || (first == 0xFE && second == 0xFF) || (first == '<' && second == 0) || (first == 0 && second == '<'))
+		{
+			LOG(LogWarning) << "Gamelist \"" << path << "\" is UTF-16 encoded, it can't be streamed and is read as a whole";
+			readWhole(path);
+			return;
+		}
+	}
+
+	// skip the declaration, comments and doctype up to the root element
+	for(;;)
+	{
+		if(!skipWhitespace())
+		{
+			fail("no root element");
+			return;
+		}
+
+		if(skipIf("<?"))
+		{
+			if(!skipPast("?>"))
+				return;
+		}else if(skipIf("<!--"))
+		{
+			if(!skipPast("-->"))
+				return;
+		}else if(skipIf("<!"))
+		{
+			if(!skipPast(">"))
+				return;
+		}else if(skipIf("<"))
+		{
+			bool selfClosing;
+			if(readStartTag(mRootName, selfClosing))
+				mDone = selfClosing;
+			return;
+		}else{
+			fail("text outside of the root element");
+			return;
+		}
+	}
+}
+
+bool GamelistReader::readWhole(const std::string& path)
+{
+	mFile.close();
+	mBuffer.clear();
+	mPos = 0;
+	mReadWhole = true;
+	mDone = true;
+
+	pugi::xml_document doc;
+	pugi::xml_parse_result result = doc.load_file(path.c_str());
+	if(!result)
+		return fail(result.description());
+
+	pugi::xml_node root = doc.document_element();
+	if(!root)
+		return fail("no root element");
+	mRootName = root.name();
+
+	for(pugi::xml_node node = root.first_child(); node; node = node.next_sibling())
+	{
+		if(node.type() != pugi::node_element)
+			continue;
+
+		Entry entry;
+		entry.tag = node.name();
+		for(pugi::xml_node child = node.first_child(); child; child = child.next_sibling())
+		{
+			if(child.type() == pugi::node_element)
+				entry.values.insert(std::make_pair(std::string(child.name()), std::string(child.text().get())));
+		}
+
+		// written back as UTF-8, like everything else that goes in the new file
+		if(mKeepRaw)
+		{
+			std::ostringstream out;
+			node.print(out, "\t", pugi::format_default, pugi::encoding_utf8, 1);
+			entry.raw = boost::trim_copy(out.str());
+		}
+
+		mWholeEntries.push_back(entry);
+	}
+
+	return true;
+}
+
+bool GamelistReader::fail(const std::string& error)
+{
+	if(mError.empty())
+		mError = error;
+	mDone = true;
+	return false;
+}
+
+bool GamelistReader::fill(size_t count)
+{
+	if(mBuffer.size() - mPos >= count)
+		return true;
+
+	// drop what's been consumed, the buffer never grows much past one chunk
+	mBuffer.erase(0, mPos);
+	mPos = 0;
+
+	char chunk[GAMELIST_CHUNK_SIZE];
+	while(mBuffer.size() < count && mFile.good())
+	{
+		mFile.read(chunk, sizeof(chunk));
+		mBuffer.append(chunk, (size_t)mFile.gcount());
+	}
+
+	return mBuffer.size() >= count;
+}
+
+bool GamelistReader::get(char& c)
+{
+	if(!fill(1))
+		return false;
+
+	c = mBuffer[mPos++];
+	if(mRaw != NULL)
+		*mRaw += c;
+	return true;
+}
+
+bool GamelistReader::skipIf(const char* str)
+{
+	size_t length = strlen(str);
+	if(!fill(length) || mBuffer.compare(mPos, length, str) != 0)
+		return false;
+
+	if(mRaw != NULL)
+		mRaw->append(mBuffer, mPos, length);
+	mPos += length;
+	return true;
+}
+
+bool GamelistReader::skipPast(const char* str)
+{
+	while(!skipIf(str))
+	{
+		char c;
+		if(!get(c))
+			return fail(std::string("unexpected end of file, expected \"") + str + "\"");
+	}
+	return true;
+}
+
+bool GamelistReader::skipWhitespace()
+{
+	while(fill(1))
+	{
+		char c = mBuffer[mPos];
+		if(c != ' ' && c != '\t' && c != '\r' && c != '\n')
+			return true;
+		get(c);
+	}
+	return false;
+}
+
+// the '<' has already been consumed
+bool GamelistReader::readStartTag(std::string& name, bool& selfClosing)
+{
+	name.clear();
+	selfClosing = false;
+
+	char c;
+	while(get(c))
+	{
+		if(c == '>')
+			return !name.empty() || fail("element without a name");
+
+		if(c == '/' && skipIf(">"))
+		{
+			selfClosing = true;
+			return !name.empty() || fail("element without a name");
+		}
+
+		if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			break;
+
+		name += c;
+	}
+
+	// attributes, which gamelists don't use for anything we need; quoted values may contain '>'
+	char quote = 0;
+	while(get(c))
+	{
+		if(quote != 0)
+		{
+			if(c == quote)
+				quote = 0;
+		}else if(c == '"' || c == '\'')
+		{
+			quote = c;
+		}else if(c == '>')
+		{
+			return true;
+		}else if(c == '/' && skipIf(">"))
+		{
+			selfClosing = true;
+			return true;
+		}
+	}
+
+	return fail("unexpected end of file in <" + name + ">");
+}
+
+bool GamelistReader::readEntity(std::string& text)
+{
+	// the '&' has already been consumed
+	std::string entity;
+	char c;
+	while(get(c) && c != ';')
+	{
+		entity += c;
+		if(entity.size() > 10)
+			return fail("bad entity &" + entity);
+	}
+
+	if(entity == "lt") text += '<';
+	else if(entity == "gt") text += '>';
+	else if(entity == "amp") text += '&';
+	else if(entity == "quot") text += '"';
+	else if(entity == "apos") text += '\'';
+	else if(entity.size() > 1 && entity[0] == '#')
+	{
+		unsigned long code = (entity[1] == 'x') ? strtoul(entity.c_str() + 2, NULL, 16) : strtoul(entity.c_str() + 1, NULL, 10);
+
+		// utf-8 encode
+		if(code < 0x80)
+		{
+			text += (char)code;
+		}else if(code < 0x800)
+		{
+			text += (char)(0xC0 | (code >> 6));
+			text += (char)(0x80 | (code & 0x3F));
+		}else if(code < 0x10000)
+		{
+			text += (char)(0xE0 | (code >> 12));
+			text += (char)(0x80 | ((code >> 6) & 0x3F));
+			text += (char)(0x80 | (code & 0x3F));
+		}else{
+			text += (char)(0xF0 | (code >> 18));
+			text += (char)(0x80 | ((code >> 12) & 0x3F));
+			text += (char)(0x80 | ((code >> 6) & 0x3F));
+			text += (char)(0x80 | (code & 0x3F));
+		}
+	}else{
+		return fail("unknown entity &" + entity + ";");
+	}
+
+	return true;
+}
+
+// reads up to and including the end tag of name; text gets the character data directly inside it,
+// values (only for entries) gets the text of each child element
+bool GamelistReader::readContent(const std::string& name, std::string* text, std::map<std::string, std::string>* values)
+{
+	char c;
+	while(get(c))
+	{
+		if(c == '<')
+		{
+			if(skipIf("/"))
+			{
+				std::string endName;
+				while(get(c) && c != '>')
+				{
+					if(c != ' ' && c != '\t' && c != '\r' && c != '\n')
+						endName += c;
+				}
+
+				if(endName != name)
+					return fail("<" + name + "> closed by </" + endName + ">");
+
+				// like pugixml, whitespace-only text counts as no text
+				if(text != NULL && text->find_first_not_of(" \t\r\n") == std::string::npos)
+					text->clear();
+				return true;
+			}else if(skipIf("!--"))
+			{
+				if(!skipPast("-->"))
+					return false;
+			}else if(skipIf("![CDATA["))
+			{
+				// taken as is, no entities or line ending changes
+				while(!skipIf("]]>"))
+				{
+					if(!get(c))
+						return fail("unexpected end of file in CDATA");
+
+					if(text != NULL)
+						*text += c;
+				}
+			}else if(skipIf("?"))
+			{
+				if(!skipPast("?>"))
+					return false;
+			}else{
+				std::string childName;
+				bool selfClosing;
+				if(!readStartTag(childName, selfClosing))
+					return false;
+
+				std::string childText;
+				if(!selfClosing && !readContent(childName, values != NULL ? &childText : NULL, NULL))
+					return false;
+
+				if(values != NULL)
+					values->insert(std::make_pair(childName, childText));
+			}
+		}else if(text != NULL)
+		{
+			if(c == '&')
+			{
+				if(!readEntity(*text))
+					return false;
+			}else if(c == '\r')
+			{
+				// line endings are normalized to \n
+				*text += '\n';
+				if(fill(1) && mBuffer[mPos] == '\n')
+					get(c);
+			}else{
+				*text += c;
+			}
+		}
+	}
+
+	return fail("unexpected end of file in <" + name + ">");
+}
+
+bool GamelistReader::next(Entry& entry)
+{
+	if(mReadWhole)
+	{
+		if(mWholeEntries.empty())
+			return false;
+
+		entry = mWholeEntries.front();
+		mWholeEntries.pop_front();
+		return true;
+	}
+
+	while(!mDone)
+	{
+		entry.tag.clear();
+		entry.values.clear();
+		entry.raw.clear();
+
+		if(!skipWhitespace())
+			return fail("unexpected end of file in <" + mRootName + ">");
+
+		if(skipIf("</"))
+		{
+			// the root is closed, we're done
+			mDone = true;
+			return false;
+		}
+
+		if(skipIf("<!--"))
+		{
+			if(!skipPast("-->"))
+				return false;
+			continue;
+		}
+
+		if(skipIf("<?"))
+		{
+			if(!skipPast("?>"))
+				return false;
+			continue;
+		}
+
+		if(!skipIf("<"))
+			return fail("text in <" + mRootName + ">");
+
+		if(mKeepRaw)
+		{
+			entry.raw = "<";
+			mRaw = &entry.raw;
+		}
+
+		bool selfClosing;
+		bool ok = readStartTag(entry.tag, selfClosing) && (selfClosing || readContent(entry.tag, NULL, &entry.values));
+		mRaw = NULL;
+		return ok;
+	}
+
+	return false;
+}
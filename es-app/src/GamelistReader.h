@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <deque>
+
+// Reads a gamelist.xml one entry at a time, without ever holding the whole document in memory.
+// Only understands what gamelists are made of: a root element with <game>, <folder> (or other)
+// entries, whose children hold plain text. Attributes are skipped, deeper nesting is ignored.
+// UTF-16 files are the exception, pugixml reads those as a whole and their entries are handed out from memory.
+class GamelistReader
+{
+public:
+	struct Entry
+	{
+		std::string tag;
+		std::map<std::string, std::string> values; // child element -> decoded text, the first one wins like pugixml's child()
+		std::string raw; // the entry exactly as it is in the file, only filled in if keepRaw is set
+	};
+
+	// keepRaw keeps the original text of every entry, so it can be written back untouched
+	GamelistReader(const std::string& path, bool keepRaw);
+
+	// Reads the next entry below the root element. Returns false once the root is closed, or on error.
+	bool next(Entry& entry);
+
+	// the root element's name, "gameList" for a valid gamelist
+	inline const std::string& getRootName() const { return mRootName; }
+	inline bool hasError() const { return !mError.empty(); }
+	inline const std::string& getError() const { return mError; }
+
+private:
+	bool fill(size_t count);
+	bool get(char& c);
+	bool skipIf(const char* str);
+	bool skipPast(const char* str);
+	bool skipWhitespace();
+
+	bool readStartTag(std::string& name, bool& selfClosing);
+	bool readContent(const std::string& name, std::string* text, std::map<std::string, std::string>* values);
+	bool readEntity(std::string& text);
+	bool fail(const std::string& error);
+	bool readWhole(const std::string& path);
+
+	std::ifstream mFile;
+	std::string mBuffer;
+	size_t mPos;
+
+	bool mKeepRaw;
+	std::string* mRaw; // where consumed characters are copied while an entry is read
+
+	bool mReadWhole;
+	std::deque<Entry> mWholeEntries; // only if mReadWhole
+
+	std::string mRootName;
+	bool mDone;
+	std::string mError;
+};
@@ -0,0 +1,131 @@
+#include "GamelistSaver.h"
+#include "SystemData.h"
+#include "Settings.h"
+#include <algorithm>
+#include <vector>
+
+// dirty systems are written at the latest this long after their first change, even if changes keep coming
+#define GAMELIST_MAX_SAVE_DELAY std::chrono::seconds(30)
+
+GamelistSaver* GamelistSaver::sInstance = NULL;
+
+GamelistSaver* GamelistSaver::getInstance()
+{
+	if(sInstance == NULL)
+		sInstance = new GamelistSaver();
+
+	return sInstance;
+}
+
+GamelistSaver::GamelistSaver()
+{
+}
+
+void GamelistSaver::markDirty(SystemData* system)
+{
+	auto now = std::chrono::steady_clock::now();
+	if(mDirty.empty())
+		mFirstChange = now;
+	mLastChange = now;
+
+	mDirty.insert(system);
+}
+
+void GamelistSaver::flushSystem(SystemData* system)
+{
+	if(mDirty.erase(system) > 0)
+		queue(system);
+}
+
+void GamelistSaver::update()
+{
+	if(mDirty.empty())
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::milliseconds delay(Settings::getInstance()->getInt("GamelistSaveDelay"));
+	if(now - mLastChange < delay && now - mFirstChange < GAMELIST_MAX_SAVE_DELAY)
+		return;
+
+	for(auto it = mDirty.begin(); it != mDirty.end(); it++)
+		queue(*it);
+	mDirty.clear();
+}
+
+void GamelistSaver::flush()
+{
+	for(auto it = mDirty.begin(); it != mDirty.end(); it++)
+		queue(*it);
+	mDirty.clear();
+
+	// the writer thread alone would write one system after another, help it out
+	std::vector<std::thread> helpers;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		size_t count = std::min(mQueue.size(), (size_t)std::max(std::thread::hardware_concurrency(), 1u));
+		for(size_t i = 0; i < count; i++)
+		{
+			helpers.push_back(std::thread([this]
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				while(writeNext(lock));
+			}));
+		}
+	}
+
+	for(auto it = helpers.begin(); it != helpers.end(); it++)
+		it->join();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	while(!mQueue.empty() || !mWriting.empty())
+		mWritten.wait(lock);
+}
+
+void GamelistSaver::queue(SystemData* system)
+{
+	// taken here on the main thread, the writer never looks at the system itself
+	GamelistUpdate update;
+	if(!prepareGamelistUpdate(system, update))
+		return;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mQueue[update.writePath] = std::move(update);
+
+	if(!mThread.joinable())
+		mThread = std::thread(&GamelistSaver::run, this);
+
+	mQueued.notify_one();
+}
+
+// writes one queued gamelist, with the lock released while writing; returns false if there was nothing to take
+bool GamelistSaver::writeNext(std::unique_lock<std::mutex>& lock)
+{
+	auto it = mQueue.begin();
+	while(it != mQueue.end() && mWriting.find(it->first) != mWriting.end())
+		it++;
+
+	if(it == mQueue.end())
+		return false;
+
+	GamelistUpdate update = std::move(it->second);
+	mQueue.erase(it);
+	mWriting.insert(update.writePath);
+
+	lock.unlock();
+	writeGamelistUpdate(update);
+	lock.lock();
+
+	mWriting.erase(update.writePath);
+	mWritten.notify_all();
+	return true;
+}
+
+void GamelistSaver::run()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	for(;;)
+	{
+		if(!writeNext(lock))
+			mQueued.wait(lock);
+	}
+}
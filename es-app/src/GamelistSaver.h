@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include "Gamelist.h"
+
+class SystemData;
+
+// Writes gamelists in the background. Systems are marked dirty as their metadata changes and are written
+// together once nothing has changed for a while, so a burst of changes (like scraping) is one write.
+// The changes themselves are collected on the main thread, only the file work happens on the writer thread.
+class GamelistSaver
+{
+public:
+	static GamelistSaver* getInstance();
+
+	// the system has unsaved metadata, it'll be written soon
+	void markDirty(SystemData* system);
+
+	// Hands the system's pending changes to the writer right away. Must be called before a dirty system is deleted.
+	void flushSystem(SystemData* system);
+
+	// Called from the main loop, queues the dirty systems once they've been left alone for long enough.
+	void update();
+
+	// Queues every dirty system and waits until everything is written, with a thread per system.
+	void flush();
+
+private:
+	static GamelistSaver* sInstance;
+
+	GamelistSaver();
+
+	void queue(SystemData* system);
+	bool writeNext(std::unique_lock<std::mutex>& lock);
+	void run();
+
+	std::set<SystemData*> mDirty;
+	std::chrono::steady_clock::time_point mFirstChange;
+	std::chrono::steady_clock::time_point mLastChange;
+
+	std::map<std::string, GamelistUpdate> mQueue; // keyed by the path written to, a newer update replaces one still waiting
+	std::set<std::string> mWriting; // paths being written right now, the same file is never written twice at once
+	std::mutex mMutex;
+	std::condition_variable mQueued;
+	std::condition_variable mWritten;
+	std::thread mThread;
+};
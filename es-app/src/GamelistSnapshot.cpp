@@ -0,0 +1,256 @@
+#include "GamelistSnapshot.h"
+#include "SystemData.h"
+#include "platform.h"
+#include "Log.h"
+#include <fstream>
+#include <cstring>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = boost::filesystem;
+
+// bump whenever the layout below or the metadata declarations change
+static const char SNAPSHOT_MAGIC[4] = { 'E', 'S', 'G', 'S' };
+static const unsigned int SNAPSHOT_VERSION = 2;
+
+// layout, all in native byte order since the cache never leaves the machine:
+//   magic, version, number of game metadata decls, xml size, xml mtime, xml hash, start path, entry count
+//   entries: type (u8), path, then the metadata as MetaDataList::writeFields() puts it
+//   strings are a u32 length followed by the bytes
+
+static unsigned long long hashFile(const std::string& path)
+{
+	// FNV-1a, read a chunk at a time so big gamelists never sit in memory
+	unsigned long long hash = 14695981039346656037ULL;
+
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+	char chunk[64 * 1024];
+	while(file.good())
+	{
+		file.read(chunk, sizeof(chunk));
+		std::streamsize count = file.gcount();
+		for(std::streamsize i = 0; i < count; i++)
+		{
+			hash ^= (unsigned char)chunk[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+template<typename T>
+static void writeValue(std::ostream& out, T value)
+{
+	out.write((const char*)&value, sizeof(T));
+}
+
+static void writeString(std::ostream& out, const std::string& str)
+{
+	writeValue<unsigned int>(out, (unsigned int)str.size());
+	out.write(str.data(), str.size());
+}
+
+// bounds-checked reading of the mapped file, a damaged snapshot just fails to load
+struct SnapshotReader
+{
+	const char* pos;
+	const char* end;
+
+	template<typename T>
+	bool read(T& value)
+	{
+		if((size_t)(end - pos) < sizeof(T))
+			return false;
+
+		memcpy(&value, pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	bool readString(const char*& str, unsigned int& length)
+	{
+		if(!read(length) || (size_t)(end - pos) < length)
+			return false;
+
+		str = pos;
+		pos += length;
+		return true;
+	}
+};
+
+GamelistSnapshot::GamelistSnapshot(SystemData* system, const std::string& xmlPath)
+	: mXmlPath(xmlPath), mStartPath(system->getStartPath()), mXmlHashed(false), mEntryCount(0)
+{
+	mPath = getHomePath() + "/.emulationstation/cache/gamelists/" + system->getName() + ".snapshot";
+
+	// the hash means reading the whole XML, it's only worked out once the cheap checks pass
+	boost::system::error_code ec;
+	mXmlSize = (unsigned long long)fs::file_size(xmlPath, ec);
+	mXmlTime = (long long)fs::last_write_time(xmlPath, ec);
+}
+
+unsigned long long GamelistSnapshot::getXmlHash() const
+{
+	if(!mXmlHashed)
+	{
+		mXmlHash = hashFile(mXmlPath);
+		mXmlHashed = true;
+	}
+	return mXmlHash;
+}
+
+GamelistSnapshot::~GamelistSnapshot()
+{
+	if(mFile.is_open())
+	{
+		mFile.close();
+
+		boost::system::error_code ec;
+		fs::remove(mPath + ".tmp", ec);
+	}
+}
+
+bool GamelistSnapshot::load(const EntryFunc& addEntry) const
+{
+#ifndef WIN32
+	int fd = open(mPath.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	size_t size = (size_t)info.st_size;
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED)
+		return false;
+
+	// check everything before touching the tree, so a bad snapshot can still fall back to the XML cleanly
+	bool loaded = readEntries((const char*)data, size, NULL) && readEntries((const char*)data, size, &addEntry);
+	munmap(data, size);
+	return loaded;
+#else
+	std::ifstream file(mPath.c_str(), std::ios::in | std::ios::binary);
+	if(!file.good())
+		return false;
+
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return readEntries(data.data(), data.size(), NULL) && readEntries(data.data(), data.size(), &addEntry);
+#endif
+}
+
+bool GamelistSnapshot::readEntries(const char* data, size_t size, const EntryFunc* addEntry) const
+{
+	SnapshotReader reader = { data, data + size };
+
+	char magic[4];
+	unsigned int version, declCount, entryCount;
+	unsigned long long xmlSize, xmlHash;
+	long long xmlTime;
+	const char* startPath;
+	unsigned int startPathLength;
+
+	if(!reader.read(magic) || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 ||
+		!reader.read(version) || version != SNAPSHOT_VERSION ||
+		!reader.read(declCount) || declCount != getMDDByType(GAME_METADATA).size() ||
+		!reader.read(xmlSize) || xmlSize != mXmlSize ||
+		!reader.read(xmlTime) || xmlTime != mXmlTime ||
+		!reader.read(xmlHash) ||
+		!reader.readString(startPath, startPathLength) || mStartPath.compare(0, std::string::npos, startPath, startPathLength) != 0 ||
+		!reader.read(entryCount) || xmlHash != getXmlHash())
+		return false;
+
+	for(unsigned int i = 0; i < entryCount; i++)
+	{
+		unsigned char type;
+		const char* path;
+		unsigned int pathLength;
+		if(!reader.read(type) || (type != GAME && type != FOLDER) || !reader.readString(path, pathLength))
+			return false;
+
+		// metadata is always read as game metadata, like the XML loader does
+		MetaDataList metadata(GAME_METADATA);
+		if(!metadata.readFields(reader.pos, reader.end, addEntry != NULL))
+			return false;
+
+		if(addEntry != NULL)
+			(*addEntry)((FileType)type, fs::path(std::string(path, pathLength)), metadata);
+	}
+
+	return reader.pos == reader.end;
+}
+
+void GamelistSnapshot::writeHeader()
+{
+	boost::system::error_code ec;
+	fs::create_directories(fs::path(mPath).parent_path(), ec);
+
+	// written next to it and renamed, so a crash never leaves half a snapshot behind
+	mFile.open((mPath + ".tmp").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	mFile.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	writeValue<unsigned int>(mFile, SNAPSHOT_VERSION);
+	writeValue<unsigned int>(mFile, (unsigned int)getMDDByType(GAME_METADATA).size());
+	writeValue<unsigned long long>(mFile, mXmlSize);
+	writeValue<long long>(mFile, mXmlTime);
+	writeValue<unsigned long long>(mFile, getXmlHash());
+	writeString(mFile, mStartPath);
+
+	// filled in by save()
+	mCountPos = mFile.tellp();
+	writeValue<unsigned int>(mFile, 0);
+}
+
+void GamelistSnapshot::add(FileType type, const fs::path& path, const MetaDataList& metadata)
+{
+	// only tried once, if it can't be opened the entries just go nowhere
+	if(mEntryCount == 0)
+		writeHeader();
+
+	writeValue<unsigned char>(mFile, (unsigned char)type);
+	writeString(mFile, path.generic_string());
+	metadata.writeFields(mFile);
+
+	mEntryCount++;
+}
+
+void GamelistSnapshot::save()
+{
+	if(mEntryCount == 0)
+		writeHeader();
+
+	if(!mFile.is_open())
+	{
+		LOG(LogWarning) << "Could not write gamelist snapshot \"" << mPath << "\"";
+		return;
+	}
+
+	mFile.seekp(mCountPos);
+	writeValue<unsigned int>(mFile, mEntryCount);
+	mFile.close();
+
+	boost::system::error_code ec;
+	std::string tempPath = mPath + ".tmp";
+	if(mFile.fail())
+	{
+		LOG(LogWarning) << "Could not write gamelist snapshot \"" << mPath << "\"";
+		fs::remove(tempPath, ec);
+		return;
+	}
+
+	fs::rename(tempPath, mPath, ec);
+	if(ec)
+	{
+		LOG(LogWarning) << "Could not write gamelist snapshot \"" << mPath << "\": " << ec.message();
+	}
+}
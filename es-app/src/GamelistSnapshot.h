@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include "FileData.h"
+#include "MetaData.h"
+
+class SystemData;
+
+// A binary copy of what parseGamelist reads from a system's gamelist.xml, kept in ~/.emulationstation/cache/gamelists/.
+// It's tied to the size, modification time and hash of the XML it was made from (the hash only once the others
+// match), and is memory mapped and applied straight to the FileData tree, so an unchanged gamelist doesn't need
+// a DOM parse on every boot.
+class GamelistSnapshot
+{
+public:
+	typedef std::function<void(FileType type, const boost::filesystem::path& path, const MetaDataList& metadata)> EntryFunc;
+
+	GamelistSnapshot(SystemData* system, const std::string& xmlPath);
+
+	// Calls addEntry for every <game> and <folder> in the snapshot, in gamelist order.
+	// Returns false, without calling it at all, if the snapshot is missing, damaged or doesn't match the XML.
+	bool load(const EntryFunc& addEntry) const;
+
+	// Entries are written out as the XML is parsed, save() finishes the file and puts it in place.
+	// A snapshot that is never saved is thrown away.
+	void add(FileType type, const boost::filesystem::path& path, const MetaDataList& metadata);
+	void save();
+
+	~GamelistSnapshot();
+
+private:
+	bool readEntries(const char* data, size_t size, const EntryFunc* addEntry) const;
+	void writeHeader();
+	unsigned long long getXmlHash() const;
+
+	std::string mPath;
+	std::string mXmlPath;
+	std::string mStartPath;
+	unsigned long long mXmlSize;
+	long long mXmlTime;
+	mutable unsigned long long mXmlHash; // only worked out when it's needed, see getXmlHash()
+	mutable bool mXmlHashed;
+
+	std::ofstream mFile; // the temporary file entries are written to
+	std::streampos mCountPos; // where the entry count goes once it's known
+	unsigned int mEntryCount;
+};
@@ -0,0 +1,346 @@
+#include "LibraryWatcher.h"
+#include "SystemData.h"
+#include "FileSorts.h"
+#include "ScanCache.h"
+#include "RomScanner.h"
+#include "CollectionSystemManager.h"
+#include "views/ViewController.h"
+#include "Settings.h"
+#include "Log.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+LibraryWatcher* LibraryWatcher::sInstance = NULL;
+
+LibraryWatcher* LibraryWatcher::getInstance()
+{
+	if(sInstance == NULL)
+		sInstance = new LibraryWatcher();
+
+	return sInstance;
+}
+
+LibraryWatcher::LibraryWatcher() : mFd(-1)
+{
+}
+
+void LibraryWatcher::watchSystem(SystemData* system)
+{
+#ifdef __linux__
+	if(mFd < 0)
+	{
+		mFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(mFd < 0)
+		{
+			LOG(LogError) << "Could not initialize inotify, library changes will not be picked up until restart";
+			return;
+		}
+	}
+
+	// the scan listed every folder already, on the loader thread, so nothing here touches the disk
+	std::vector<std::string> folders;
+	system->takeScannedFolders(folders);
+	if(folders.empty())
+	{
+		// there was no scan, the folders in the tree will have to do
+		FileData* root = system->getRootFolder();
+		folders.push_back(root->getPath().generic_string());
+
+		std::vector<FileData*> tree = root->getFilesRecursive(FOLDER);
+		for(auto it = tree.begin(); it != tree.end(); it++)
+		{
+			folders.push_back(std::string());
+			(*it)->appendPath(folders.back());
+		}
+	}
+
+	for(auto it = folders.begin(); it != folders.end(); it++)
+		addWatch(system, *it);
+#endif
+}
+
+void LibraryWatcher::unwatchAll()
+{
+#ifdef __linux__
+	if(mFd >= 0)
+		close(mFd);
+#endif
+
+	mFd = -1;
+	mWatches.clear();
+	mChangedFolders.clear();
+}
+
+// returns false if the folder can't be watched or the system watches it already
+bool LibraryWatcher::addWatch(SystemData* system, const std::string& path)
+{
+#ifdef __linux__
+	int wd = inotify_add_watch(mFd, path.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+	if(wd < 0)
+	{
+		LOG(LogWarning) << "Could not watch folder \"" << path << "\"";
+		return false;
+	}
+
+	// the same folder always gets the same watch
+	Watch& watch = mWatches[wd];
+	if(std::find(watch.systems.begin(), watch.systems.end(), system) != watch.systems.end())
+		return false;
+
+	if(watch.path.empty())
+		watch.path = path;
+	watch.systems.push_back(system);
+	return true;
+#else
+	return false;
+#endif
+}
+
+// a folder that showed up while running, it and everything below it are watched
+void LibraryWatcher::watchFolder(SystemData* system, const std::string& path)
+{
+#ifdef __linux__
+	// a folder watched already is also what stops symlink loops
+	if(!addWatch(system, path))
+		return;
+
+	std::vector<ScanCache::Entry> entries;
+	if(!ScanCache::getInstance()->getFolderEntries(path, entries))
+		return;
+
+	RomScanner scanner(system->getExtensions(), Settings::getInstance()->getBool("CaseInsensitiveExtensions"));
+	for(auto it = entries.begin(); it != entries.end(); it++)
+	{
+		if(it->isDirectory && !RomScanner::isStemless(it->name) && !scanner.matchesExtension(it->name))
+			watchFolder(system, path + "/" + it->name);
+	}
+#endif
+}
+
+void LibraryWatcher::unwatchFolder(const std::string& path)
+{
+#ifdef __linux__
+	// a folder that was moved away keeps its watches, so drop everything that was under it
+	const std::string prefix = path + "/";
+	for(auto it = mWatches.begin(); it != mWatches.end(); )
+	{
+		if(it->second.path == path || it->second.path.compare(0, prefix.size(), prefix) == 0)
+		{
+			inotify_rm_watch(mFd, it->first);
+			it = mWatches.erase(it);
+		}else{
+			it++;
+		}
+	}
+#endif
+}
+
+void LibraryWatcher::update()
+{
+#ifdef __linux__
+	if(mFd < 0)
+		return;
+
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length;
+	while((length = read(mFd, buffer, sizeof(buffer))) > 0)
+	{
+		const struct inotify_event* event;
+		for(char* ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len)
+		{
+			event = (const struct inotify_event*)ptr;
+
+			if(event->mask & IN_Q_OVERFLOW)
+			{
+				LOG(LogWarning) << "Too many library changes at once, some will only show up after a restart";
+				continue;
+			}
+
+			auto watch = mWatches.find(event->wd);
+			if(watch == mWatches.end())
+				continue;
+
+			if(event->mask & IN_IGNORED)
+			{
+				mWatches.erase(watch);
+				continue;
+			}
+
+			// events about the watched folder itself have no name
+			if(event->len == 0)
+				continue;
+
+			// copied, adding a folder can add watches
+			const std::string folderPath = watch->second.path;
+			const std::vector<SystemData*> systems = watch->second.systems;
+			const std::string fileName = event->name;
+			bool isDirectory = (event->mask & IN_ISDIR) != 0;
+
+			if(event->mask & (IN_CREATE | IN_MOVED_TO))
+			{
+				for(auto it = systems.begin(); it != systems.end(); it++)
+				{
+					addFile(*it, folderPath, fileName, isDirectory);
+					if(isDirectory)
+						watchFolder(*it, folderPath + "/" + fileName);
+				}
+			}else if(event->mask & (IN_DELETE | IN_MOVED_FROM))
+			{
+				for(auto it = systems.begin(); it != systems.end(); it++)
+					removeFile(*it, folderPath, fileName);
+
+				if(isDirectory)
+					unwatchFolder(folderPath + "/" + fileName);
+			}
+		}
+	}
+
+	// the new files are in place already, each folder's view is refreshed once per batch, not once per file
+	for(auto it = mChangedFolders.begin(); it != mChangedFolders.end(); it++)
+	{
+		FileData* folder = getFolder(it->first, it->second, false);
+		if(folder != NULL)
+			ViewController::get()->onFileChanged(folder, FILE_ADDED);
+	}
+	mChangedFolders.clear();
+#endif
+}
+
+void LibraryWatcher::addFile(SystemData* system, const std::string& folderPath, const std::string& fileName, bool isDirectory)
+{
+	// a folder that was created and then filled may already have been scanned with its contents
+	FileData* parent = getFolder(system, folderPath, false);
+	if(parent != NULL && parent->getChildrenByFilename().find(fileName) != parent->getChildrenByFilename().end())
+		return;
+
+	FileData* file = system->createFileData(folderPath + "/" + fileName, isDirectory);
+	if(file == NULL)
+		return;
+
+	// folders without games aren't in the tree, so they're only added now that they have one
+	if(parent == NULL)
+		parent = getFolder(system, folderPath, true);
+
+	if(parent == NULL)
+	{
+		delete file;
+		return;
+	}
+
+	// in the order the folder is shown in, which the user may have picked
+	const FileData::SortType sortType = parent->getSortType(FileSorts::SortTypes.at(0));
+	if(file->getType() == FOLDER)
+		file->sort(sortType);
+	parent->addChild(file);
+	parent->sortChild(file, sortType);
+
+	std::vector<FileData*> games;
+	if(file->getType() == GAME)
+		games.push_back(file);
+	else
+		games = file->getFilesRecursive(GAME);
+
+	for(auto it = games.begin(); it != games.end(); it++)
+	{
+		system->getIndex()->addToIndex(*it);
+		CollectionSystemManager::get()->refreshCollectionSystems(*it);
+	}
+
+	LOG(LogInfo) << "Added \"" << file->getPath().generic_string() << "\" to system \"" << system->getName() << "\"";
+	mChangedFolders.insert(std::make_pair(system, folderPath));
+}
+
+void LibraryWatcher::removeFile(SystemData* system, const std::string& folderPath, const std::string& fileName)
+{
+	FileData* parent = getFolder(system, folderPath, false);
+	if(parent == NULL)
+		return;
+
+	auto it = parent->getChildrenByFilename().find(fileName);
+	if(it == parent->getChildrenByFilename().end())
+		return;
+
+	LOG(LogInfo) << "Removed \"" << it->second->getPath().generic_string() << "\" from system \"" << system->getName() << "\"";
+	removeTree(it->second);
+
+	// the scan leaves out folders without games, so do the same here
+	while(parent != system->getRootFolder() && parent->getChildren().size() == 0)
+	{
+		FileData* next = parent->getParent();
+		removeTree(parent);
+		parent = next;
+	}
+}
+
+// deletes everything below folder, no view may be showing any of it
+static void deleteChildren(FileData* folder)
+{
+	while(folder->getChildren().size() > 0)
+	{
+		FileData* child = folder->getChildren().back();
+		deleteChildren(child);
+
+		if(child->getType() == GAME)
+			CollectionSystemManager::get()->deleteCollectionFiles(child);
+
+		delete child;
+	}
+}
+
+void LibraryWatcher::removeTree(FileData* file)
+{
+	std::shared_ptr<IGameListView> view = ViewController::get()->getGameListView(file->getSystem());
+
+	// if the view is somewhere inside this folder, move it out first so it never points at something that's gone
+	for(FileData* cursor = view->getCursor(); cursor != NULL; cursor = cursor->getParent())
+	{
+		if(cursor->getParent() == file)
+		{
+			view->setCursor(file);
+			break;
+		}
+	}
+
+	deleteChildren(file);
+
+	if(file->getType() == GAME)
+		CollectionSystemManager::get()->deleteCollectionFiles(file);
+
+	view->remove(file, false);
+}
+
+FileData* LibraryWatcher::getFolder(SystemData* system, const std::string& path, bool create)
+{
+	const std::string rootPath = system->getRootFolder()->getPath().generic_string();
+	const size_t rootLength = std::min(rootPath.size() + 1, path.size());
+
+	FileData* folder;
+	size_t missingStart;
+	bool found = system->findFile(path.substr(rootLength), &folder, &missingStart) != NULL;
+
+	// a folder matching an extension is a game, nothing inside it is tracked
+	if(folder->getType() != FOLDER)
+		return NULL;
+	if(found)
+		return folder;
+	if(!create)
+		return NULL;
+
+	for(size_t start = rootLength + missingStart; start < path.size(); )
+	{
+		size_t end = std::min(path.find('/', start), path.size());
+
+		FileData* child = new (system->getFileArena()) FileData(FOLDER, path.substr(start, end - start), system);
+		folder->addChild(child);
+		folder->sortChild(child, folder->getSortType(FileSorts::SortTypes.at(0)));
+		folder = child;
+
+		start = end + 1;
+	}
+
+	return folder;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+class SystemData;
+class FileData;
+
+// Watches the folders of every system with inotify and applies file changes to the FileData trees,
+// so ROMs that are added or removed show up without a rescan. Only does something on Linux.
+class LibraryWatcher
+{
+public:
+	static LibraryWatcher* getInstance();
+
+	void watchSystem(SystemData* system);
+	void unwatchAll();
+
+	// Applies the pending file events, called from the main loop. Never blocks.
+	void update();
+
+private:
+	struct Watch
+	{
+		std::string path;
+		std::vector<SystemData*> systems; // systems sharing a folder share its watch
+	};
+
+	static LibraryWatcher* sInstance;
+
+	LibraryWatcher();
+
+	bool addWatch(SystemData* system, const std::string& path);
+	void watchFolder(SystemData* system, const std::string& path);
+	void unwatchFolder(const std::string& path);
+
+	void addFile(SystemData* system, const std::string& folderPath, const std::string& fileName, bool isDirectory);
+	void removeFile(SystemData* system, const std::string& folderPath, const std::string& fileName);
+	void removeTree(FileData* file);
+	FileData* getFolder(SystemData* system, const std::string& path, bool create);
+
+	int mFd;
+	std::map<int, Watch> mWatches;
+	// folders that got something added, by path since a later event may remove them; their views are told once per batch
+	std::set< std::pair<SystemData*, std::string> > mChangedFolders;
+};
@@ -1,7 +1,9 @@
 #include "MetaData.h"
+#include "FileData.h"
 #include "components/TextComponent.h"
 #include "Log.h"
 #include "Util.h"
+#include <cstring>
 
 namespace fs = boost::filesystem;
 
@@ -55,16 +57,152 @@ const std::vector<MetaDataDecl>& getMDDByType(MetaDataListType type)
 	return gameMDD;
 }
 
+MetaDataId getMetaDataId(const std::string& key)
+{
+	static const char* keys[META_COUNT] = { "name", "desc", "image", "video", "marquee", "thumbnail", "rating",
+		"releasedate", "developer", "publisher", "genre", "players", "favorite", "playcount", "lastplayed" };
+
+	for(int i = 0; i < META_COUNT; i++)
+	{
+		if(key == keys[i])
+			return (MetaDataId)i;
+	}
 
+	return META_COUNT;
+}
+
+// the decl for every id, per list type; ids a type doesn't have use the game decl
+struct DeclTable
+{
+	const MetaDataDecl* decls[META_COUNT];
+	StringPool::Id defaultIds[META_COUNT];
+
+	DeclTable(MetaDataListType type)
+	{
+		for(int i = 0; i < META_COUNT; i++)
+			decls[i] = NULL;
+
+		const std::vector<MetaDataDecl>* mdds[2] = { &getMDDByType(type), &gameMDD };
+		for(int m = 0; m < 2; m++)
+		{
+			for(auto it = mdds[m]->begin(); it != mdds[m]->end(); it++)
+			{
+				MetaDataId id = getMetaDataId(it->key);
+				if(id != META_COUNT && decls[id] == NULL)
+				{
+					decls[id] = &(*it);
+					defaultIds[id] = StringPool::getInstance()->intern(it->defaultValue);
+				}
+			}
+		}
+	}
+};
+
+static const DeclTable& getDeclTable(MetaDataListType type)
+{
+	static const DeclTable gameTable(GAME_METADATA);
+	static const DeclTable folderTable(FOLDER_METADATA);
+
+	return (type == FOLDER_METADATA) ? folderTable : gameTable;
+}
+
+const MetaDataDecl& MetaDataList::getDecl(MetaDataId id) const
+{
+	return *getDeclTable(mType).decls[id];
+}
+
+std::atomic<unsigned int> MetaDataList::sChangeCount(0);
 
 MetaDataList::MetaDataList(MetaDataListType type)
-	: mType(type), mWasChanged(false)
+	: mType(type), mWasChanged(true), mVersion(0), mOwner(NULL) // a new list counts as changed, it always did
 {
-	const std::vector<MetaDataDecl>& mdd = getMDD();
-	for(auto iter = mdd.begin(); iter != mdd.end(); iter++)
-		set(iter->key, iter->defaultValue);
+	for(int i = 0; i < META_COUNT; i++)
+		mFields[i].form = FIELD_DEFAULT;
+}
+
+MetaDataList::MetaDataList(const MetaDataList& other)
+	: mType(other.mType), mWasChanged(other.mWasChanged), mVersion(other.mVersion), mOwner(NULL)
+{
+	copyFields(other);
+}
+
+MetaDataList::MetaDataList(MetaDataList&& other)
+	: mType(other.mType), mWasChanged(other.mWasChanged), mVersion(other.mVersion), mOwner(NULL)
+{
+	// the text is taken over, other is left with defaults
+	for(int i = 0; i < META_COUNT; i++)
+	{
+		mFields[i] = other.mFields[i];
+		other.mFields[i].form = FIELD_DEFAULT;
+	}
+}
+
+MetaDataList::~MetaDataList()
+{
+	for(int i = 0; i < META_COUNT; i++)
+		clearField(mFields[i]);
+}
+
+MetaDataList& MetaDataList::operator=(const MetaDataList& other)
+{
+	if(this != &other)
+	{
+		for(int i = 0; i < META_COUNT; i++)
+			clearField(mFields[i]);
+
+		mType = other.mType;
+		mWasChanged = other.mWasChanged;
+		copyFields(other);
+		changed();
+	}
+
+	return *this;
+}
+
+MetaDataList& MetaDataList::operator=(MetaDataList&& other)
+{
+	if(this != &other)
+	{
+		for(int i = 0; i < META_COUNT; i++)
+		{
+			clearField(mFields[i]);
+			mFields[i] = other.mFields[i];
+			other.mFields[i].form = FIELD_DEFAULT;
+		}
+
+		mType = other.mType;
+		mWasChanged = other.mWasChanged;
+		changed();
+	}
+
+	return *this;
 }
 
+void MetaDataList::changed()
+{
+	mVersion++;
+	sChangeCount.fetch_add(1, std::memory_order_relaxed);
+
+	if(mOwner != NULL)
+		mOwner->metadataChanged();
+}
+
+void MetaDataList::clearField(Field& field)
+{
+	if(field.form == FIELD_TEXT)
+		delete field.text;
+	field.form = FIELD_DEFAULT;
+}
+
+void MetaDataList::copyFields(const MetaDataList& other)
+{
+	for(int i = 0; i < META_COUNT; i++)
+	{
+		mFields[i] = other.mFields[i];
+		if(mFields[i].form == FIELD_TEXT)
+			mFields[i].text = new std::string(*other.mFields[i].text);
+	}
+}
 
 MetaDataList MetaDataList::createFromXML(MetaDataListType type, pugi::xml_node node, const fs::path& relativeTo)
 {
@@ -92,34 +230,279 @@ MetaDataList MetaDataList::createFromXML(MetaDataListType type, pugi::xml_node n
 	return mdl;
 }
 
+MetaDataList MetaDataList::createFromValues(MetaDataListType type, const std::map<std::string, std::string>& values, const fs::path& relativeTo)
+{
+	MetaDataList mdl(type);
+
+	const std::vector<MetaDataDecl>& mdd = mdl.getMDD();
+
+	for(auto iter = mdd.begin(); iter != mdd.end(); iter++)
+	{
+		auto value = values.find(iter->key);
+		if(value != values.end())
+		{
+			// if it's a path, resolve relative paths
+			if (iter->type == MD_PATH)
+				mdl.set(iter->key, resolvePath(value->second, relativeTo, true).generic_string());
+			else
+				mdl.set(iter->key, value->second);
+		}else{
+			mdl.set(iter->key, iter->defaultValue);
+		}
+	}
+
+	return mdl;
+}
+
 void MetaDataList::appendToXML(pugi::xml_node parent, bool ignoreDefaults, const fs::path& relativeTo) const
 {
 	const std::vector<MetaDataDecl>& mdd = getMDD();
 
 	for(auto mddIter = mdd.begin(); mddIter != mdd.end(); mddIter++)
 	{
-		auto mapIter = mMap.find(mddIter->key);
-		if(mapIter != mMap.end())
+		MetaDataId id = getMetaDataId(mddIter->key);
+
+		// if it's just the default (and we ignore defaults), don't write it
+		if(ignoreDefaults && mFields[id].form == FIELD_DEFAULT)
+			continue;
+
+		// try and make paths relative if we can
+		std::string value = get(id);
+		if (mddIter->type == MD_PATH)
+			value = makeRelativePath(value, relativeTo, true).generic_string();
+
+		parent.append_child(mddIter->key.c_str()).text().set(value.c_str());
+	}
+}
+
+template<typename T>
+static void writeRaw(std::ostream& out, const T& value)
+{
+	out.write((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+static bool readRaw(const char*& data, const char* end, T& value)
+{
+	if((size_t)(end - data) < sizeof(T))
+		return false;
+
+	memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+static bool isReal(MetaDataType type)
+{
+	return type == MD_FLOAT || type == MD_RATING;
+}
+
+// a count (u8), then for every value its id (u8), its form (u8) and the value itself: a precision (u8) and a float
+// for reals, a long long for other natives, a u32 length and the bytes for strings; pooled values are written as
+// their text, StringPool ids only last for one run
+void MetaDataList::writeFields(std::ostream& out) const
+{
+	unsigned char count = 0;
+	for(int i = 0; i < META_COUNT; i++)
+	{
+		if(mFields[i].form != FIELD_DEFAULT)
+			count++;
+	}
+
+	writeRaw(out, count);
+	for(int i = 0; i < META_COUNT; i++)
+	{
+		const Field& field = mFields[i];
+		if(field.form == FIELD_DEFAULT)
+			continue;
+
+		writeRaw(out, (unsigned char)i);
+		writeRaw(out, field.form);
+		if(field.form == FIELD_NATIVE)
 		{
-			// we have this value!
-			// if it's just the default (and we ignore defaults), don't write it
-			if(ignoreDefaults && mapIter->second == mddIter->defaultValue)
-				continue;
-			
-			// try and make paths relative if we can
-			std::string value = mapIter->second;
-			if (mddIter->type == MD_PATH)
-				value = makeRelativePath(value, relativeTo, true).generic_string();
-
-			parent.append_child(mapIter->first.c_str()).text().set(value.c_str());
+			if(isReal(getDecl((MetaDataId)i).type))
+			{
+				writeRaw(out, field.precision);
+				writeRaw(out, field.real);
+			}else{
+				writeRaw(out, field.integer);
+			}
+		}else{
+			const std::string& text = getString((MetaDataId)i);
+			writeRaw(out, (unsigned int)text.size());
+			out.write(text.data(), text.size());
 		}
 	}
 }
 
+bool MetaDataList::readFields(const char*& data, const char* end, bool apply)
+{
+	unsigned char count;
+	if(!readRaw(data, end, count))
+		return false;
+
+	for(unsigned char v = 0; v < count; v++)
+	{
+		unsigned char id;
+		Field field;
+		if(!readRaw(data, end, id) || id >= META_COUNT || !readRaw(data, end, field.form) || field.form == FIELD_DEFAULT || field.form > FIELD_POOLED)
+			return false;
+
+		if(field.form == FIELD_NATIVE)
+		{
+			bool read = isReal(getDecl((MetaDataId)id).type) ? (readRaw(data, end, field.precision) && readRaw(data, end, field.real)) : readRaw(data, end, field.integer);
+			if(!read)
+				return false;
+		}else{
+			unsigned int length;
+			if(!readRaw(data, end, length) || (size_t)(end - data) < length)
+				return false;
+
+			if(apply && field.form == FIELD_TEXT)
+				field.text = new std::string(data, length);
+			else if(apply)
+				field.pooled = StringPool::getInstance()->intern(std::string(data, length));
+			data += length;
+		}
+
+		if(apply)
+		{
+			clearField(mFields[id]);
+			mFields[id] = field;
+		}
+	}
+
+	if(apply)
+	{
+		mWasChanged = true;
+		changed();
+	}
+	return true;
+}
+
+// reads value into a native field if writing it back out gives exactly value again
+static bool parseInteger(const std::string& value, long long& integer)
+{
+	size_t start = (value.size() > 1 && value[0] == '-') ? 1 : 0;
+	if(value.size() == start || value.size() - start > 9 || (value[start] == '0' && value.size() > start + 1))
+		return false;
+
+	for(size_t i = start; i < value.size(); i++)
+	{
+		if(value[i] < '0' || value[i] > '9')
+			return false;
+	}
+
+	integer = atoll(value.c_str());
+	return !(integer == 0 && start == 1); // "-0"
+}
+
+static bool parseReal(const std::string& value, float& real, unsigned char& precision)
+{
+	size_t dot = value.find('.');
+	if(value.empty() || value.size() > 24)
+		return false;
+
+	precision = (dot == std::string::npos) ? 0 : (unsigned char)(value.size() - dot - 1);
+	real = (float)atof(value.c_str());
+
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", (int)precision, real);
+	return value == buffer;
+}
+
+static bool parseDate(const std::string& value, long long& packed)
+{
+	// YYYYMMDDTHHMMSS, what boost::posix_time::to_iso_string() writes for whole seconds
+	if(value.size() != 15 || value[8] != 'T')
+		return false;
+
+	packed = 0;
+	for(size_t i = 0; i < value.size(); i++)
+	{
+		if(i == 8)
+			continue;
+		if(value[i] < '0' || value[i] > '9')
+			return false;
+		packed = packed * 10 + (value[i] - '0');
+	}
+
+	return true;
+}
+
+// values repeated across many games: credits and genres, and whatever doesn't fit the native form
+// of a number or date (like "1-4" players), which is almost always one of a few spellings
+static bool isPooled(MetaDataId id, MetaDataType type)
+{
+	switch(type)
+	{
+	case MD_STRING:
+		return id == META_DEVELOPER || id == META_PUBLISHER || id == META_GENRE;
+	case MD_MULTILINE_STRING:
+	case MD_PATH:
+		return false;
+	default:
+		return true;
+	}
+}
+
 void MetaDataList::set(const std::string& key, const std::string& value)
 {
-	mMap[key] = value;
+	MetaDataId id = getMetaDataId(key);
+	if(id == META_COUNT)
+	{
+		LOG(LogWarning) << "Unknown metadata \"" << key << "\", ignoring";
+		return;
+	}
+
+	set(id, value);
+}
+
+void MetaDataList::set(MetaDataId id, const std::string& value)
+{
 	mWasChanged = true;
+	changed();
+
+	const MetaDataDecl& decl = getDecl(id);
+	Field& field = mFields[id];
+	clearField(field);
+
+	if(value == decl.defaultValue)
+		return;
+
+	bool native = false;
+	switch(decl.type)
+	{
+	case MD_INT:
+		native = parseInteger(value, field.integer);
+		break;
+	case MD_BOOL:
+		native = (value == "true" || value == "false");
+		field.integer = (value == "true");
+		break;
+	case MD_FLOAT:
+	case MD_RATING:
+		native = parseReal(value, field.real, field.precision);
+		break;
+	case MD_DATE:
+	case MD_TIME:
+		native = parseDate(value, field.integer);
+		break;
+	default:
+		break;
+	}
+
+	if(native)
+	{
+		field.form = FIELD_NATIVE;
+	}else if(isPooled(id, decl.type))
+	{
+		field.form = FIELD_POOLED;
+		field.pooled = StringPool::getInstance()->intern(value);
+	}else{
+		field.form = FIELD_TEXT;
+		field.text = new std::string(value);
+	}
 }
 
 void MetaDataList::setTime(const std::string& key, const boost::posix_time::ptime& time)
@@ -127,32 +510,125 @@ void MetaDataList::setTime(const std::string& key, const boost::posix_time::ptim
 	set(key, boost::posix_time::to_iso_string(time));
 }
 
-const std::string& MetaDataList::get(const std::string& key) const
+std::string MetaDataList::get(const std::string& key) const
+{
+	MetaDataId id = getMetaDataId(key);
+	return (id != META_COUNT) ? get(id) : std::string();
+}
+
+std::string MetaDataList::get(MetaDataId id) const
 {
-	return mMap.at(key);
+	const Field& field = mFields[id];
+	if(field.form != FIELD_NATIVE)
+		return getString(id);
+
+	char buffer[64];
+	switch(getDecl(id).type)
+	{
+	case MD_BOOL:
+		return field.integer ? "true" : "false";
+	case MD_FLOAT:
+	case MD_RATING:
+		snprintf(buffer, sizeof(buffer), "%.*f", (int)field.precision, field.real);
+		return buffer;
+	case MD_DATE:
+	case MD_TIME:
+		snprintf(buffer, sizeof(buffer), "%08lldT%06lld", field.integer / 1000000, field.integer % 1000000);
+		return buffer;
+	default:
+		return std::to_string(field.integer);
+	}
+}
+
+const std::string& MetaDataList::getString(MetaDataId id) const
+{
+	const Field& field = mFields[id];
+	if(field.form == FIELD_TEXT)
+		return *field.text;
+	if(field.form == FIELD_POOLED)
+		return StringPool::getInstance()->get(field.pooled);
+
+	// natives only exist for non-string types, getString() isn't for those
+	return getDecl(id).defaultValue;
+}
+
+StringPool::Id MetaDataList::getStringId(MetaDataId id) const
+{
+	const Field& field = mFields[id];
+	if(field.form == FIELD_POOLED)
+		return field.pooled;
+	if(field.form == FIELD_DEFAULT)
+		return getDeclTable(mType).defaultIds[id];
+
+	return StringPool::getInstance()->intern(get(id));
 }
 
 int MetaDataList::getInt(const std::string& key) const
 {
-	return atoi(get(key).c_str());
+	MetaDataId id = getMetaDataId(key);
+	return (id != META_COUNT) ? getInt(id) : 0;
+}
+
+int MetaDataList::getInt(MetaDataId id) const
+{
+	const Field& field = mFields[id];
+	if(field.form == FIELD_NATIVE && (getDecl(id).type == MD_INT || getDecl(id).type == MD_BOOL))
+		return (int)field.integer;
+
+	return atoi(get(id).c_str());
 }
 
 float MetaDataList::getFloat(const std::string& key) const
 {
-	return (float)atof(get(key).c_str());
+	MetaDataId id = getMetaDataId(key);
+	return (id != META_COUNT) ? getFloat(id) : 0.0f;
+}
+
+float MetaDataList::getFloat(MetaDataId id) const
+{
+	const Field& field = mFields[id];
+	if(field.form == FIELD_NATIVE && (getDecl(id).type == MD_FLOAT || getDecl(id).type == MD_RATING))
+		return field.real;
+
+	return (float)atof(get(id).c_str());
 }
 
 boost::posix_time::ptime MetaDataList::getTime(const std::string& key) const
 {
-	return string_to_ptime(get(key), "%Y%m%dT%H%M%S%F%q");
+	MetaDataId id = getMetaDataId(key);
+	return (id != META_COUNT) ? getTime(id) : boost::posix_time::ptime();
+}
+
+boost::posix_time::ptime MetaDataList::getTime(MetaDataId id) const
+{
+	const Field& field = mFields[id];
+	if(field.form == FIELD_NATIVE && (getDecl(id).type == MD_DATE || getDecl(id).type == MD_TIME))
+	{
+		// no need for a stream and a facet to read it
+		long long date = field.integer / 1000000;
+		long long time = field.integer % 1000000;
+		try
+		{
+			return boost::posix_time::ptime(boost::gregorian::date((unsigned short)(date / 10000), (unsigned short)(date / 100 % 100), (unsigned short)(date % 100)),
+				boost::posix_time::time_duration((int)(time / 10000), (int)(time / 100 % 100), (int)(time % 100)));
+		}catch(std::exception&)
+		{
+			return boost::posix_time::ptime();
+		}
+	}
+
+	return string_to_ptime(get(id), "%Y%m%dT%H%M%S%F%q");
 }
 
-bool MetaDataList::isDefault()
+bool MetaDataList::isDefault() const
 {
 	const std::vector<MetaDataDecl>& mdd = getMDD();
 
-	for (int i = 1; i < mMap.size(); i++) {
-		if (mMap.at(mdd[i].key) != mdd[i].defaultValue) return false;
+	// the name doesn't count
+	for(unsigned int i = 1; i < mdd.size(); i++)
+	{
+		if(mFields[getMetaDataId(mdd[i].key)].form != FIELD_DEFAULT)
+			return false;
 	}
 
 	return true;
@@ -3,9 +3,14 @@
 #include "pugixml/src/pugixml.hpp"
 #include <string>
 #include <map>
+#include <ostream>
+#include <atomic>
 #include "GuiComponent.h"
 #include <boost/date_time.hpp>
 #include <boost/filesystem.hpp>
+#include "StringPool.h"
+
+class FileData;
 
 enum MetaDataType
 {
@@ -39,34 +44,123 @@ enum MetaDataListType
 	FOLDER_METADATA
 };
 
+// every metadata key there is, game and folder lists use the same ids
+enum MetaDataId
+{
+	META_NAME,
+	META_DESC,
+	META_IMAGE,
+	META_VIDEO,
+	META_MARQUEE,
+	META_THUMBNAIL,
+	META_RATING,
+	META_RELEASEDATE,
+	META_DEVELOPER,
+	META_PUBLISHER,
+	META_GENRE,
+	META_PLAYERS,
+	META_FAVORITE,
+	META_PLAYCOUNT,
+	META_LASTPLAYED,
+
+	META_COUNT // also what getMetaDataId() returns for keys it doesn't know
+};
+
 const std::vector<MetaDataDecl>& getMDDByType(MetaDataListType type);
+MetaDataId getMetaDataId(const std::string& key);
 
+// Values are kept in one fixed slot per id instead of a map of strings. Defaults aren't stored at all,
+// numbers, bools and dates are stored natively as long as they read back exactly as they were set,
+// values shared by many games go in the StringPool, and only the remaining strings are allocated.
 class MetaDataList
 {
 public:
 	static MetaDataList createFromXML(MetaDataListType type, pugi::xml_node node, const boost::filesystem::path& relativeTo);
+	static MetaDataList createFromValues(MetaDataListType type, const std::map<std::string, std::string>& values, const boost::filesystem::path& relativeTo);
 	void appendToXML(pugi::xml_node parent, bool ignoreDefaults, const boost::filesystem::path& relativeTo) const;
 
+	// The values that aren't the default, in the form they're kept in, so GamelistSnapshot can load them again
+	// without going through strings. readFields() moves data past what it read and returns false if it's damaged;
+	// unless apply is set it only checks.
+	void writeFields(std::ostream& out) const;
+	bool readFields(const char*& data, const char* end, bool apply);
+
 	MetaDataList(MetaDataListType type);
-	
+	MetaDataList(const MetaDataList& other);
+	MetaDataList(MetaDataList&& other);
+	~MetaDataList();
+
+	MetaDataList& operator=(const MetaDataList& other);
+	MetaDataList& operator=(MetaDataList&& other);
+
 	void set(const std::string& key, const std::string& value);
+	void set(MetaDataId id, const std::string& value);
 	void setTime(const std::string& key, const boost::posix_time::ptime& time); //times are internally stored as ISO strings (e.g. boost::posix_time::to_iso_string(ptime))
 
-	const std::string& get(const std::string& key) const;
+	std::string get(const std::string& key) const;
+	std::string get(MetaDataId id) const;
 	int getInt(const std::string& key) const;
+	int getInt(MetaDataId id) const;
 	float getFloat(const std::string& key) const;
+	float getFloat(MetaDataId id) const;
 	boost::posix_time::ptime getTime(const std::string& key) const;
+	boost::posix_time::ptime getTime(MetaDataId id) const;
+
+	// for string and path values, which can be returned without a copy
+	const std::string& getString(MetaDataId id) const;
 
-	bool isDefault();
+	// the value's id in the StringPool, free for pooled values like developer or genre
+	StringPool::Id getStringId(MetaDataId id) const;
+
+	bool isDefault() const;
 
 	bool wasChanged() const;
 	void resetChangedFlag();
 
+	// goes up with every change to the list, and is never reset
+	inline unsigned int getVersion() const { return mVersion; }
+
+	// goes up with every change to any list, so results worked out from metadata can tell they're still current
+	static inline unsigned int getChangeCount() { return sChangeCount.load(std::memory_order_relaxed); }
+
 	inline MetaDataListType getType() const { return mType; }
 	inline const std::vector<MetaDataDecl>& getMDD() const { return getMDDByType(getType()); }
 
+	// the file told about every change from now on; it stays with the list, copies and assignments don't move it
+	inline void setOwner(FileData* owner) { mOwner = owner; }
+
 private:
+	enum FieldForm
+	{
+		FIELD_DEFAULT, // the decl's default value
+		FIELD_NATIVE, // integer or real, depending on the decl's type
+		FIELD_TEXT, // a string of its own, like a name or a path
+		FIELD_POOLED // a string from the StringPool, for values many games share
+	};
+
+	struct Field
+	{
+		unsigned char form;
+		unsigned char precision; // decimals a real was written with
+		union
+		{
+			long long integer; // MD_INT, MD_BOOL, and MD_DATE/MD_TIME packed as YYYYMMDDHHMMSS
+			float real; // MD_FLOAT and MD_RATING
+			std::string* text;
+			StringPool::Id pooled;
+		};
+	};
+
+	const MetaDataDecl& getDecl(MetaDataId id) const;
+	void clearField(Field& field);
+	void copyFields(const MetaDataList& other);
+	void changed();
+
 	MetaDataListType mType;
-	std::map<std::string, std::string> mMap;
+	Field mFields[META_COUNT];
 	bool mWasChanged;
+	unsigned int mVersion;
+	FileData* mOwner;
+
+	static std::atomic<unsigned int> sChangeCount;
 };
@@ -0,0 +1,128 @@
+#include "PlayStatsJournal.h"
+#include "SystemData.h"
+#include "GamelistSaver.h"
+#include "platform.h"
+#include "Log.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <algorithm>
+
+namespace fs = boost::filesystem;
+
+// the journal is compacted into gamelist.xml once it's grown past this many bytes
+#define PLAYSTATS_COMPACT_SIZE (16 * 1024)
+
+// one line per launch: the path relative to the system's root folder, then key=value for each statistic,
+// separated by tabs; a line without its newline was cut off and is ignored
+
+namespace PlayStatsJournal
+{
+	std::string getPath(SystemData* system)
+	{
+		return getHomePath() + "/.emulationstation/gamelists/" + system->getName() + "/playstats.journal";
+	}
+
+	long long getSize(const std::string& path)
+	{
+		boost::system::error_code ec;
+		uintmax_t size = fs::file_size(path, ec);
+		return ec ? -1 : (long long)size;
+	}
+
+	void record(FileData* game)
+	{
+		SystemData* system = game->getSystem();
+		const std::string rootPath = system->getRootFolder()->getPath().generic_string() + "/";
+		const std::string path = game->getPath().generic_string();
+
+		// paths with our separators in them are rare enough to just leave to the next gamelist write
+		if(path.compare(0, rootPath.size(), rootPath) != 0 || path.find_first_of("\t\n") != std::string::npos)
+			return;
+
+		std::string line = path.substr(rootPath.size());
+		const std::vector<MetaDataDecl>& mdd = game->metadata.getMDD();
+		for(auto it = mdd.begin(); it != mdd.end(); it++)
+		{
+			if(it->isStatistic)
+				line += "\t" + it->key + "=" + game->metadata.get(it->key);
+		}
+		line += "\n";
+
+		std::string journalPath = getPath(system);
+		boost::system::error_code ec;
+		fs::create_directories(fs::path(journalPath).parent_path(), ec);
+
+		// written in one go, so a crash leaves at most one cut off line
+		std::ofstream file(journalPath.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+		file.write(line.data(), line.size());
+		file.close();
+
+		if(file.fail())
+		{
+			LOG(LogWarning) << "Could not write play statistics to \"" << journalPath << "\"";
+			return;
+		}
+
+		if(getSize(journalPath) > PLAYSTATS_COMPACT_SIZE)
+			GamelistSaver::getInstance()->markDirty(system);
+	}
+
+	void replay(SystemData* system)
+	{
+		std::string journalPath = getPath(system);
+		std::ifstream file(journalPath.c_str(), std::ios::in | std::ios::binary);
+		if(!file.good())
+			return;
+
+		std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+
+		unsigned int count = 0;
+		for(size_t start = 0, end; (end = data.find('\n', start)) != std::string::npos; start = end + 1)
+		{
+			size_t pathEnd = std::min(data.find('\t', start), end);
+
+			FileData* game = system->findFile(data.substr(start, pathEnd - start));
+
+			// gone since, or not a game
+			if(game == NULL || game->getType() != GAME)
+				continue;
+
+			for(size_t pos = pathEnd; pos < end; )
+			{
+				size_t next = std::min(data.find('\t', pos + 1), end);
+				std::string value = data.substr(pos + 1, next - pos - 1);
+				pos = next;
+
+				size_t separator = value.find('=');
+				if(separator == std::string::npos)
+					continue;
+
+				// only statistics are ever taken from the journal
+				std::string key = value.substr(0, separator);
+				const std::vector<MetaDataDecl>& mdd = game->metadata.getMDD();
+				for(auto it = mdd.begin(); it != mdd.end(); it++)
+				{
+					if(it->isStatistic && it->key == key)
+					{
+						game->metadata.set(key, value.substr(separator + 1));
+						break;
+					}
+				}
+			}
+
+			count++;
+		}
+
+		LOG(LogInfo) << "Replayed " << count << " play statistics for system \"" << system->getName() << "\"";
+	}
+
+	void discard(const std::string& path, long long size)
+	{
+		if(size < 0 || getSize(path) != size)
+			return;
+
+		boost::system::error_code ec;
+		fs::remove(path, ec);
+	}
+};
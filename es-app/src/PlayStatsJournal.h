@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+class SystemData;
+class FileData;
+
+// Play statistics (the metadata marked isStatistic) are appended to a small per-system journal when a game
+// is launched, instead of rewriting the gamelist. The journal is replayed on top of the gamelist when the
+// system loads, and folded back into gamelist.xml whenever that's written, which then removes it.
+// Lines hold the absolute values, so replaying a line twice does no harm.
+namespace PlayStatsJournal
+{
+	std::string getPath(SystemData* system);
+
+	// Size in bytes of the journal at path, -1 if there is none.
+	long long getSize(const std::string& path);
+
+	// Appends the statistics of game to its system's journal. Once it has grown large enough,
+	// the system is handed to the GamelistSaver so it gets compacted.
+	void record(FileData* game);
+
+	// Applies the system's journal to its games. Safe to call from the system loader threads.
+	void replay(SystemData* system);
+
+	// Removes the journal at path after a gamelist write took it in, unless it grew since (size is what it was then).
+	void discard(const std::string& path, long long size);
+};
@@ -0,0 +1,295 @@
+#include "RomScanner.h"
+#include "Log.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
+namespace fs = boost::filesystem;
+
+RomScanner::RomScanner(const std::vector<std::string>& extensions, bool caseInsensitive)
+	: mCaseInsensitive(caseInsensitive), mScannedEntries(0), mStartTime(std::chrono::steady_clock::now())
+{
+	for(auto it = extensions.begin(); it != extensions.end(); it++)
+	{
+		std::string extension = *it;
+		if(mCaseInsensitive)
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		mExtensions.insert(extension);
+	}
+}
+
+bool RomScanner::statFolder(const std::string& path, FolderId& id)
+{
+#ifndef WIN32
+	// stat follows symlinks, so a link back up the tree resolves to a folder we've already seen
+	struct stat info;
+	if(stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+		return false;
+
+	id = FolderId((unsigned long long)info.st_dev, (unsigned long long)info.st_ino);
+	return true;
+#else
+	id = FolderId(0, 0);
+	return fs::is_directory(path);
+#endif
+}
+
+bool RomScanner::enterFolder(const std::string& path, bool isDirectory, const FolderId& id)
+{
+	if(!isDirectory)
+	{
+		LOG(LogWarning) << "Error - folder with path \"" << path << "\" is not a directory!";
+		return false;
+	}
+
+#ifndef WIN32
+	if(std::find(mOpenFolders.begin(), mOpenFolders.end(), id) != mOpenFolders.end())
+#else
+	//if this symlink resolves to somewhere that's at the beginning of our path, it's gonna recurse
+	if(fs::is_symlink(path) && path.find(fs::canonical(path).generic_string()) == 0)
+#endif
+	{
+		LOG(LogWarning) << "Skipping infinitely recursive symlink \"" << path << "\"";
+		return false;
+	}
+
+	return true;
+}
+
+bool RomScanner::openFolder(const std::string& path, std::vector<ScanCache::Entry>& entries)
+{
+	auto prefetched = mPrefetched.find(path);
+	if(prefetched == mPrefetched.end())
+	{
+		FolderId id;
+		bool isDirectory = statFolder(path, id);
+		if(!enterFolder(path, isDirectory, id) || !ScanCache::getInstance()->getFolderEntries(path, entries))
+			return false;
+
+		mOpenFolders.push_back(id);
+		mOpenedFolders.push_back(path);
+		return true;
+	}
+
+	FolderListing& listing = prefetched->second;
+	if(!enterFolder(path, listing.isDirectory, listing.id) || !listing.listed)
+		return false;
+
+	entries.swap(listing.entries);
+	mOpenFolders.push_back(listing.id);
+	mOpenedFolders.push_back(path);
+	return true;
+}
+
+void RomScanner::closeFolder()
+{
+	mOpenFolders.pop_back();
+}
+
+void RomScanner::prefetch(const std::string& rootPath, unsigned int threadCount)
+{
+#ifndef WIN32
+	std::vector<WorkQueue> queues(threadCount);
+	std::mutex prefetchedMutex;
+
+	// children are counted before their parent is done, so this only reaches 0 once the walk is over
+	std::atomic<int> pendingTasks(1);
+	ScanTask rootTask = { rootPath, std::vector<FolderId>() };
+	queues[0].push(rootTask);
+
+	// idle threads sleep until a folder is queued or the walk is over; the version goes up with either,
+	// so one that looked at the queues just before is woken all the same
+	std::mutex idleMutex;
+	std::condition_variable workChanged;
+	unsigned long long workVersion = 0;
+	auto signalWork = [&idleMutex, &workChanged, &workVersion]()
+	{
+		{
+			std::unique_lock<std::mutex> lock(idleMutex);
+			workVersion++;
+		}
+		workChanged.notify_all();
+	};
+
+	auto walk = [this, threadCount, &queues, &prefetchedMutex, &pendingTasks, &idleMutex, &workChanged, &workVersion, &signalWork](unsigned int queueId)
+	{
+		ScanTask task;
+		while(pendingTasks > 0)
+		{
+			unsigned long long seenVersion;
+			{
+				std::unique_lock<std::mutex> lock(idleMutex);
+				seenVersion = workVersion;
+			}
+
+			bool found = queues[queueId].pop(task);
+			for(unsigned int i = 1; !found && i < threadCount; i++)
+				found = queues[(queueId + i) % threadCount].steal(task);
+
+			if(!found)
+			{
+				std::unique_lock<std::mutex> lock(idleMutex);
+				workChanged.wait(lock, [&workVersion, seenVersion, &pendingTasks]() { return workVersion != seenVersion || pendingTasks == 0; });
+				continue;
+			}
+
+			FolderListing listing;
+			listing.isDirectory = statFolder(task.path, listing.id);
+
+			// don't follow a symlink back into one of our own parents, openFolder() will skip it anyway
+			bool isLoop = std::find(task.ancestors.begin(), task.ancestors.end(), listing.id) != task.ancestors.end();
+			listing.listed = listing.isDirectory && !isLoop && ScanCache::getInstance()->getFolderEntries(task.path, listing.entries);
+
+			bool queued = false;
+			if(listing.listed)
+			{
+				ScanTask childTask;
+				childTask.ancestors = task.ancestors;
+				childTask.ancestors.push_back(listing.id);
+				for(auto it = listing.entries.begin(); it != listing.entries.end(); it++)
+				{
+					if(isSubfolder(*it))
+					{
+						childTask.path = task.path + "/" + it->name;
+						pendingTasks++;
+						queues[queueId].push(childTask);
+						queued = true;
+					}
+				}
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(prefetchedMutex);
+				mPrefetched[task.path] = std::move(listing);
+			}
+
+			if(--pendingTasks == 0 || queued)
+				signalWork();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(unsigned int i = 1; i < threadCount; i++)
+		threads.push_back(std::thread(walk, i));
+	walk(0);
+	for(auto it = threads.begin(); it != threads.end(); it++)
+		it->join();
+#endif
+}
+
+bool RomScanner::isSubfolder(const ScanCache::Entry& entry) const
+{
+	// same rules as populateFolder: folders matching an extension are games, not subfolders
+	return entry.isDirectory && !isStemless(entry.name) && !matchesExtension(entry.name);
+}
+
+void RomScanner::WorkQueue::push(const ScanTask& task)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mTasks.push_back(task);
+}
+
+bool RomScanner::WorkQueue::pop(ScanTask& task)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if(mTasks.empty())
+		return false;
+
+	task = mTasks.back();
+	mTasks.pop_back();
+	return true;
+}
+
+bool RomScanner::WorkQueue::steal(ScanTask& task)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if(mTasks.empty())
+		return false;
+
+	task = mTasks.front();
+	mTasks.pop_front();
+	return true;
+}
+
+bool RomScanner::matchesExtension(const std::string& fileName) const
+{
+	size_t dot = fileName.rfind('.');
+	if(dot == std::string::npos)
+		return false;
+
+	std::string extension = fileName.substr(dot);
+	if(mCaseInsensitive)
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	return mExtensions.find(extension) != mExtensions.end();
+}
+
+void RomScanner::logStats(const std::string& systemName) const
+{
+	long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mStartTime).count();
+	LOG(LogInfo) << "Scanned " << mScannedEntries << " entries for system \"" << systemName << "\" in " << ms << "ms ("
+		<< (ms > 0 ? (mScannedEntries * 1000 / ms) : mScannedEntries) << " entries/s)";
+}
+
+bool RomScanner::readFolder(const std::string& path, std::vector<ScanCache::Entry>& entries)
+{
+#ifndef WIN32
+	DIR* dir = opendir(path.c_str());
+	if(dir == NULL)
+	{
+		LOG(LogWarning) << "Error reading folder \"" << path << "\"";
+		return false;
+	}
+
+	std::string entryPath;
+	for(struct dirent* ent = readdir(dir); ent != NULL; ent = readdir(dir))
+	{
+		const char* name = ent->d_name;
+		if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+			continue;
+
+		bool isDirectory = ent->d_type == DT_DIR;
+
+		// the filesystem didn't tell us, or it's a symlink that may point to a folder
+		if(ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK)
+		{
+			struct stat info;
+			entryPath = path + "/" + name;
+			isDirectory = stat(entryPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+		}
+
+		ScanCache::Entry entry = { name, isDirectory };
+		entries.push_back(entry);
+	}
+
+	closedir(dir);
+#else
+	boost::system::error_code ec;
+	fs::directory_iterator dir(path, ec);
+	if(ec)
+	{
+		LOG(LogWarning) << "Error reading folder \"" << path << "\": " << ec.message();
+		return false;
+	}
+
+	for(fs::directory_iterator end; dir != end; dir.increment(ec))
+	{
+		if(ec)
+			break;
+
+		const fs::path& filePath = (*dir).path();
+		ScanCache::Entry entry = { filePath.filename().string(), fs::is_directory(filePath, ec) };
+		entries.push_back(entry);
+	}
+#endif
+
+	return true;
+}
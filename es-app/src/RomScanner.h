@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+#include <chrono>
+#include "ScanCache.h"
+
+// Does the filesystem work for SystemData::populateFolder with as few syscalls as possible.
+// Folders are read with readdir, using d_type and only falling back to stat when it's unknown,
+// extensions are matched through a hashed set and symlink loops are detected by (dev, inode).
+class RomScanner
+{
+public:
+	typedef std::pair<unsigned long long, unsigned long long> FolderId; // (dev, inode)
+
+	RomScanner(const std::vector<std::string>& extensions, bool caseInsensitive);
+
+	// Lists the folder at path, from the prefetched listings if there are any.
+	// Returns false if path isn't a directory or is a symlink back to a folder it's opened from.
+	// A folder that was opened is closed with closeFolder() once everything below it is done.
+	bool openFolder(const std::string& path, std::vector<ScanCache::Entry>& entries);
+	void closeFolder();
+
+	// every folder openFolder() has listed, in the order it did
+	inline std::vector<std::string>& getOpenedFolders() { return mOpenedFolders; }
+
+	// Walks the tree under rootPath with several directory enumerations in flight, so the
+	// round trips of network mounts overlap. openFolder() then serves the listings from memory,
+	// so the FileData tree is still built in the same order as a serial scan.
+	void prefetch(const std::string& rootPath, unsigned int threadCount);
+
+	bool matchesExtension(const std::string& fileName) const;
+
+	// Dot-prefixed names without another period (".nes") have no stem and are skipped.
+	static inline bool isStemless(const std::string& fileName) { return fileName.empty() || (fileName[0] == '.' && fileName.find('.', 1) == std::string::npos); }
+
+	// Counts entries handled by populateFolder, for the scan rate log.
+	inline void addScannedEntries(size_t count) { mScannedEntries += count; }
+	void logStats(const std::string& systemName) const;
+
+	// Lists a folder without building a boost::filesystem::path per entry.
+	static bool readFolder(const std::string& path, std::vector<ScanCache::Entry>& entries);
+
+private:
+	struct FolderListing
+	{
+		bool isDirectory;
+		bool listed;
+		FolderId id;
+		std::vector<ScanCache::Entry> entries;
+	};
+
+	struct ScanTask
+	{
+		std::string path;
+		std::vector<FolderId> ancestors;
+	};
+
+	// Pending folders of one prefetch thread. The owner works from the back (depth first),
+	// idle threads steal from the front, where the bigger subtrees usually are.
+	class WorkQueue
+	{
+	public:
+		void push(const ScanTask& task);
+		bool pop(ScanTask& task);
+		bool steal(ScanTask& task);
+
+	private:
+		std::deque<ScanTask> mTasks;
+		std::mutex mMutex;
+	};
+
+	static bool statFolder(const std::string& path, FolderId& id);
+	bool enterFolder(const std::string& path, bool isDirectory, const FolderId& id);
+	bool isSubfolder(const ScanCache::Entry& entry) const;
+
+	std::unordered_set<std::string> mExtensions;
+	bool mCaseInsensitive;
+	std::vector<FolderId> mOpenFolders; // the folder being read and its ancestors; a second link to a folder is fine
+	std::vector<std::string> mOpenedFolders;
+	std::map<std::string, FolderListing> mPrefetched;
+	size_t mScannedEntries;
+	std::chrono::steady_clock::time_point mStartTime;
+};
@@ -0,0 +1,162 @@
+#include "ScanCache.h"
+#include "pugixml/src/pugixml.hpp"
+#include <boost/filesystem.hpp>
+#include "platform.h"
+#include "Settings.h"
+#include "Log.h"
+#include "RomScanner.h"
+
+namespace fs = boost::filesystem;
+
+ScanCache* ScanCache::sInstance = NULL;
+
+ScanCache::ScanCache() : mDirty(false)
+{
+	if(Settings::getInstance()->getBool("ScanCache"))
+		load();
+}
+
+ScanCache* ScanCache::getInstance()
+{
+	if(sInstance == NULL)
+		sInstance = new ScanCache();
+
+	return sInstance;
+}
+
+std::string ScanCache::getCachePath()
+{
+	return getHomePath() + "/.emulationstation/cache/scan_manifest.xml";
+}
+
+void ScanCache::load()
+{
+	std::string path = getCachePath();
+	if(!fs::exists(path))
+		return;
+
+	pugi::xml_document doc;
+	pugi::xml_parse_result result = doc.load_file(path.c_str());
+	if(!result)
+	{
+		LOG(LogWarning) << "Could not parse scan cache \"" << path << "\", folders will be rescanned.\n	" << result.description();
+		return;
+	}
+
+	pugi::xml_node root = doc.child("scanCache");
+	for(pugi::xml_node folderNode = root.child("folder"); folderNode; folderNode = folderNode.next_sibling("folder"))
+	{
+		Folder& folder = mFolders[folderNode.attribute("path").as_string()];
+		folder.mtime = (std::time_t)folderNode.attribute("mtime").as_double();
+		folder.visited = false;
+		folder.scanning = false;
+
+		for(pugi::xml_node entryNode = folderNode.first_child(); entryNode; entryNode = entryNode.next_sibling())
+		{
+			Entry entry = { entryNode.attribute("name").as_string(), std::string(entryNode.name()) == "dir" };
+			folder.entries.push_back(entry);
+		}
+	}
+
+	LOG(LogInfo) << "Loaded scan cache with " << mFolders.size() << " folders";
+}
+
+void ScanCache::save()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if(!mDirty || !Settings::getInstance()->getBool("ScanCache"))
+		return;
+
+	pugi::xml_document doc;
+	pugi::xml_node root = doc.append_child("scanCache");
+	for(auto it = mFolders.begin(); it != mFolders.end(); it++)
+	{
+		// forget about folders nothing pointed at this time
+		if(!it->second.visited)
+			continue;
+
+		pugi::xml_node folderNode = root.append_child("folder");
+		folderNode.append_attribute("path").set_value(it->first.c_str());
+		folderNode.append_attribute("mtime").set_value((double)it->second.mtime);
+
+		for(auto entryIt = it->second.entries.begin(); entryIt != it->second.entries.end(); entryIt++)
+			folderNode.append_child(entryIt->isDirectory ? "dir" : "file").append_attribute("name").set_value(entryIt->name.c_str());
+	}
+
+	fs::path path(getCachePath());
+	fs::create_directories(path.parent_path());
+
+	// written next to it and renamed, so a crash never leaves half a manifest behind
+	boost::system::error_code ec;
+	std::string tempPath = path.string() + ".tmp";
+	if(!doc.save_file(tempPath.c_str()))
+	{
+		LOG(LogError) << "Error saving scan cache to \"" << path << "\"!";
+		fs::remove(tempPath, ec);
+		return;
+	}
+
+	fs::rename(tempPath, path, ec);
+	if(ec)
+	{
+		LOG(LogError) << "Error saving scan cache to \"" << path << "\": " << ec.message();
+		return;
+	}
+
+	mDirty = false;
+}
+
+bool ScanCache::getFolderEntries(const std::string& folderPath, std::vector<Entry>& entries)
+{
+	if(!Settings::getInstance()->getBool("ScanCache"))
+		return RomScanner::readFolder(folderPath, entries);
+
+	boost::system::error_code ec;
+	std::time_t mtime = fs::last_write_time(folderPath, ec);
+	if(ec)
+		return false;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	// another system may be scanning the same path right now, wait for it instead of doing it twice
+	auto it = mFolders.find(folderPath);
+	while(it != mFolders.end() && it->second.scanning)
+	{
+		mScanned.wait(lock);
+		it = mFolders.find(folderPath);
+	}
+
+	if(it != mFolders.end() && it->second.mtime == mtime)
+	{
+		it->second.visited = true;
+		entries = it->second.entries;
+		return true;
+	}
+
+	// map nodes don't move, so this stays valid while the lock is released
+	Folder& folder = mFolders[folderPath];
+	folder.scanning = true;
+	lock.unlock();
+
+	std::vector<Entry> scanned;
+	bool success = RomScanner::readFolder(folderPath, scanned);
+
+	lock.lock();
+	if(success)
+	{
+		// mtimes only have a resolution of one second, so a folder modified just now could still
+		// change without its mtime moving; leave it untrusted so it's scanned again next time
+		folder.mtime = (std::time(NULL) - mtime > 2) ? mtime : 0;
+		folder.entries = scanned;
+		folder.visited = true;
+		folder.scanning = false;
+		mDirty = true;
+	}else{
+		mFolders.erase(folderPath);
+	}
+	mScanned.notify_all();
+	lock.unlock();
+
+	entries.swap(scanned);
+	return success;
+}
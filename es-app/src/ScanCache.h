@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+
+// Remembers the contents of every scanned ROM folder, keyed on the folder's modification time.
+// The manifest is kept in ~/.emulationstation/cache/ so unchanged folders don't have to be
+// enumerated again on the next boot. Folders are also shared between systems within a run,
+// so two systems pointing at the same path only scan it once.
+class ScanCache
+{
+public:
+	struct Entry
+	{
+		std::string name;
+		bool isDirectory;
+	};
+
+	static ScanCache* getInstance();
+
+	// Fills entries with the contents of folderPath, from the manifest if the folder is unchanged.
+	// Returns false if folderPath could not be read. Safe to call from the system loader threads.
+	bool getFolderEntries(const std::string& folderPath, std::vector<Entry>& entries);
+
+	// Writes the folders used during this run back to disk, if anything changed.
+	void save();
+
+	static std::string getCachePath();
+
+private:
+	struct Folder
+	{
+		std::time_t mtime;
+		std::vector<Entry> entries;
+		bool visited; // used during this run, only visited folders are written back
+		bool scanning; // another thread is currently enumerating it
+	};
+
+	static ScanCache* sInstance;
+
+	ScanCache();
+	void load();
+
+	std::map<std::string, Folder> mFolders;
+	std::mutex mMutex;
+	std::condition_variable mScanned;
+	bool mDirty;
+};
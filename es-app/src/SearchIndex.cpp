@@ -0,0 +1,342 @@
+#include "SearchIndex.h"
+#include "FileData.h"
+#include "SystemData.h"
+#include "Util.h"
+#include "Log.h"
+#include <algorithm>
+#include <cctype>
+
+// the docs are built again once this many, and more than half of them, are removed or outdated
+#define MIN_DEAD_DOCS_TO_COMPACT 1024
+
+static inline unsigned int makeTrigram(const char* text)
+{
+	return ((unsigned char)text[0] << 16) | ((unsigned char)text[1] << 8) | (unsigned char)text[2];
+}
+
+// every three characters in a row of an upper case text that don't include a space,
+// a query is split into words so it never looks for more
+static void addTrigrams(const std::string& text, std::vector<unsigned int>& out)
+{
+	for(size_t i = 0; i + 3 <= text.size(); i++)
+	{
+		if(isspace((unsigned char)text[i]) || isspace((unsigned char)text[i + 1]) || isspace((unsigned char)text[i + 2]))
+			continue;
+
+		out.push_back(makeTrigram(text.c_str() + i));
+	}
+}
+
+static std::string getSearchedDesc(FileData* game)
+{
+	std::string desc = game->metadata.getString(META_DESC).substr(0, SEARCH_DESC_LENGTH);
+	return strToUpper(desc);
+}
+
+SearchIndex* SearchIndex::getInstance()
+{
+	// each SystemData constructor adds its system, and those run on the loader threads; mMutex covers the rest
+	static SearchIndex* instance = new SearchIndex();
+	return instance;
+}
+
+SearchIndex::SearchIndex() : mDeadDocs(0), mMetadataChanges(MetaDataList::getChangeCount())
+{
+}
+
+void SearchIndex::addSystem(SystemData* system)
+{
+	const std::vector<FileData*>& games = system->getGames();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	mSystems.insert(system);
+	for(auto it = games.begin(); it != games.end(); it++)
+		indexGame(*it);
+
+	LOG(LogDebug) << "SearchIndex: added " << games.size() << " games of " << system->getName() << ", " << mPostings.size() << " trigrams in total";
+}
+
+void SearchIndex::removeSystem(SystemData* system)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	if(!mSystems.erase(system))
+		return;
+
+	if(mSystems.empty())
+	{
+		mDocs.clear();
+		mDocIds.clear();
+		mPostings.clear();
+		mDeadDocs = 0;
+		return;
+	}
+
+	for(auto it = mDocs.begin(); it != mDocs.end(); it++)
+	{
+		if(it->game && it->game->getSystem() == system)
+			unindexGame(it->game);
+	}
+}
+
+void SearchIndex::addGame(FileData* game)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	if(mSystems.count(game->getSystem()) && !mDocIds.count(game))
+		indexGame(game);
+}
+
+void SearchIndex::removeGame(FileData* game)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	if(mDocIds.count(game))
+		unindexGame(game);
+}
+
+void SearchIndex::indexGame(FileData* game)
+{
+	StringPool* pool = StringPool::getInstance();
+
+	Doc doc;
+	doc.game = game;
+	doc.metadataVersion = game->metadata.getVersion();
+	doc.name = game->metadata.getString(META_NAME);
+	strToUpper(doc.name);
+	doc.developer = pool->getUpperId(game->metadata.getStringId(META_DEVELOPER));
+	doc.publisher = pool->getUpperId(game->metadata.getStringId(META_PUBLISHER));
+
+	std::vector<unsigned int> trigrams;
+	addTrigrams(doc.name, trigrams);
+	addTrigrams(pool->get(doc.developer), trigrams);
+	addTrigrams(pool->get(doc.publisher), trigrams);
+	addTrigrams(getSearchedDesc(game), trigrams);
+
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	const unsigned int id = (unsigned int)mDocs.size();
+	for(auto it = trigrams.begin(); it != trigrams.end(); it++)
+		mPostings[*it].push_back(id);
+
+	mDocIds[game] = id;
+	mDocs.push_back(std::move(doc));
+}
+
+void SearchIndex::unindexGame(FileData* game)
+{
+	auto it = mDocIds.find(game);
+	mDocs[it->second].game = NULL;
+	mDocIds.erase(it);
+	mDeadDocs++;
+}
+
+void SearchIndex::refresh()
+{
+	if(mDeadDocs >= MIN_DEAD_DOCS_TO_COMPACT && mDeadDocs * 2 > mDocs.size())
+		compact();
+
+	const unsigned int changes = MetaDataList::getChangeCount();
+	if(changes == mMetadataChanges)
+		return;
+	mMetadataChanges = changes;
+
+	// a game whose metadata changed goes in again as a new doc
+	std::vector<FileData*> changed;
+	for(auto it = mDocs.begin(); it != mDocs.end(); it++)
+	{
+		if(it->game && it->game->metadata.getVersion() != it->metadataVersion)
+			changed.push_back(it->game);
+	}
+
+	for(auto it = changed.begin(); it != changed.end(); it++)
+	{
+		unindexGame(*it);
+		indexGame(*it);
+	}
+}
+
+void SearchIndex::compact()
+{
+	std::vector<FileData*> games;
+	games.reserve(mDocs.size() - mDeadDocs);
+	for(auto it = mDocs.begin(); it != mDocs.end(); it++)
+	{
+		if(it->game)
+			games.push_back(it->game);
+	}
+
+	mDocs.clear();
+	mDocIds.clear();
+	mPostings.clear();
+	mDeadDocs = 0;
+
+	for(auto it = games.begin(); it != games.end(); it++)
+		indexGame(*it);
+}
+
+int SearchIndex::scoreDoc(const Doc& doc, const std::vector<std::string>& words, bool searchDesc) const
+{
+	const StringPool* pool = StringPool::getInstance();
+	const std::string& developer = pool->get(doc.developer);
+	const std::string& publisher = pool->get(doc.publisher);
+	std::string desc;
+	bool descLoaded = false;
+
+	int score = 0;
+	for(auto word = words.begin(); word != words.end(); word++)
+	{
+		// the name counts most, more so where the word starts it or one of its words
+		size_t pos = doc.name.find(*word);
+		if(pos != std::string::npos)
+		{
+			if(pos == 0)
+				score += (word->size() == doc.name.size()) ? 120 : 100;
+			else if(!isalnum((unsigned char)doc.name[pos - 1]))
+				score += 60;
+			else
+				score += 40;
+			continue;
+		}
+
+		if(developer.find(*word) != std::string::npos || publisher.find(*word) != std::string::npos)
+		{
+			score += 20;
+			continue;
+		}
+
+		if(searchDesc)
+		{
+			if(!descLoaded)
+			{
+				desc = getSearchedDesc(doc.game);
+				descLoaded = true;
+			}
+
+			if(desc.find(*word) != std::string::npos)
+			{
+				score += 5;
+				continue;
+			}
+		}
+
+		return 0;
+	}
+
+	return score;
+}
+
+std::vector<SearchIndex::Result> SearchIndex::search(const std::string& query, unsigned int maxResults)
+{
+	std::vector<Result> results;
+
+	std::vector<std::string> words;
+	std::string upperQuery = strToUpper(query.c_str());
+	for(size_t start = 0; start < upperQuery.size(); )
+	{
+		if(isspace((unsigned char)upperQuery[start]))
+		{
+			start++;
+			continue;
+		}
+
+		size_t end = start;
+		while(end < upperQuery.size() && !isspace((unsigned char)upperQuery[end]))
+			end++;
+		words.push_back(upperQuery.substr(start, end - start));
+		start = end;
+	}
+
+	if(words.empty())
+		return results;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	refresh();
+
+	// a doc has to have every trigram of the query, a trigram nobody has means there's nothing to find
+	std::vector<unsigned int> trigrams;
+	for(auto it = words.begin(); it != words.end(); it++)
+		addTrigrams(*it, trigrams);
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	std::vector<const std::vector<unsigned int>*> lists;
+	for(auto it = trigrams.begin(); it != trigrams.end(); it++)
+	{
+		auto postings = mPostings.find(*it);
+		if(postings == mPostings.end())
+			return results;
+		lists.push_back(&postings->second);
+	}
+
+	// the shortest list first, the candidates only get fewer from there
+	std::sort(lists.begin(), lists.end(), [](const std::vector<unsigned int>* a, const std::vector<unsigned int>* b) { return a->size() < b->size(); });
+
+	std::vector<unsigned int> candidates;
+	if(lists.empty())
+	{
+		// every word is shorter than a trigram, so every doc is a candidate
+		candidates.reserve(mDocs.size());
+		for(unsigned int i = 0; i < mDocs.size(); i++)
+			candidates.push_back(i);
+	}else{
+		candidates = *lists.front();
+		for(auto list = lists.begin() + 1; list != lists.end() && !candidates.empty(); list++)
+		{
+			// both are sorted, so each candidate is searched for after the last one found
+			auto from = (*list)->begin();
+			size_t kept = 0;
+			for(size_t i = 0; i < candidates.size(); i++)
+			{
+				from = std::lower_bound(from, (*list)->end(), candidates[i]);
+				if(from == (*list)->end())
+					break;
+				if(*from == candidates[i])
+					candidates[kept++] = candidates[i];
+			}
+			candidates.resize(kept);
+		}
+	}
+
+	// trigrams only narrow it down, the words still have to be found in one piece; descriptions aren't
+	// looked at for words that short, they'd match nearly everything
+	std::vector< std::pair<int, unsigned int> > matches; // score, doc id
+	for(auto it = candidates.begin(); it != candidates.end(); it++)
+	{
+		const Doc& doc = mDocs[*it];
+		if(!doc.game)
+			continue;
+
+		int score = scoreDoc(doc, words, !lists.empty());
+		if(score > 0)
+			matches.push_back(std::make_pair(score, *it));
+	}
+
+	auto better = [this](const std::pair<int, unsigned int>& a, const std::pair<int, unsigned int>& b) -> bool {
+		if(a.first != b.first)
+			return a.first > b.first;
+		return mDocs[a.second].name < mDocs[b.second].name;
+	};
+
+	if(matches.size() > maxResults)
+	{
+		std::partial_sort(matches.begin(), matches.begin() + maxResults, matches.end(), better);
+		matches.resize(maxResults);
+	}else{
+		std::sort(matches.begin(), matches.end(), better);
+	}
+
+	results.reserve(matches.size());
+	for(auto it = matches.begin(); it != matches.end(); it++)
+	{
+		Result result;
+		result.game = mDocs[it->second].game;
+		result.score = it->first;
+		results.push_back(result);
+	}
+
+	return results;
+}
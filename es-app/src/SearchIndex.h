@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include "StringPool.h"
+
+class FileData;
+class SystemData;
+
+// only this much of a description is searched, the start of it says what the game is about
+// and the rest would double the size of the index
+#define SEARCH_DESC_LENGTH 160
+
+// Finds games by part of their name, developer, publisher or description, in every game system.
+// Each run of three characters (a trigram) points at the games that contain it, so a query only looks
+// at games that have all of its trigrams. Loader threads add their systems as they finish, the rest
+// happens on the main thread.
+class SearchIndex
+{
+public:
+	struct Result
+	{
+		FileData* game;
+		int score;
+	};
+
+	static SearchIndex* getInstance();
+
+	void addSystem(SystemData* system);
+	void removeSystem(SystemData* system);
+
+	// for games that come or go after their system was added
+	void addGame(FileData* game);
+	void removeGame(FileData* game);
+
+	// Every word of the query has to be found somewhere, case doesn't matter. Best matches first, at most maxResults.
+	std::vector<Result> search(const std::string& query, unsigned int maxResults);
+
+private:
+	struct Doc
+	{
+		FileData* game; // NULL once removed, its postings are dropped on the next compact()
+		unsigned int metadataVersion;
+		std::string name; // upper case, kept to check and rank candidates without touching the metadata
+		StringPool::Id developer; // upper case
+		StringPool::Id publisher;
+	};
+
+	SearchIndex();
+
+	void indexGame(FileData* game);
+	void unindexGame(FileData* game);
+	void refresh();
+	void compact();
+	int scoreDoc(const Doc& doc, const std::vector<std::string>& words, bool searchDesc) const;
+
+	std::vector<Doc> mDocs;
+	unsigned int mDeadDocs;
+	std::unordered_map<const FileData*, unsigned int> mDocIds;
+	// trigram -> the docs that have it; doc ids only ever grow, so every list stays sorted
+	std::unordered_map<unsigned int, std::vector<unsigned int> > mPostings;
+	std::unordered_set<const SystemData*> mSystems;
+	unsigned int mMetadataChanges; // MetaDataList::getChangeCount() when refresh() last looked
+	std::mutex mMutex;
+};
@@ -0,0 +1,236 @@
+#include "SmartCollectionQuery.h"
+#include "SystemData.h"
+#include "Util.h"
+#include "Log.h"
+#include <boost/algorithm/string.hpp>
+#include <fstream>
+#include <stdlib.h>
+#include <cctype>
+
+SmartCollectionQuery::SmartCollectionQuery()
+{
+}
+
+bool SmartCollectionQuery::load(const std::string& path)
+{
+	mConditions.clear();
+
+	std::ifstream input(path);
+	if(!input.is_open())
+	{
+		LOG(LogError) << "Couldn't open smart collection query at " << path;
+		return false;
+	}
+
+	const std::vector<MetaDataDecl>& mdd = getMDDByType(GAME_METADATA);
+
+	unsigned int lineNumber = 0;
+	for(std::string line; getline(input, line); )
+	{
+		lineNumber++;
+		boost::trim(line);
+		if(line.empty() || line[0] == '#')
+			continue;
+
+		size_t pos = line.find_first_of("=!<>");
+		if(pos == std::string::npos || pos == 0)
+		{
+			LOG(LogWarning) << "Smart collection query " << path << ":" << lineNumber << ": expected \"key operator value\", ignoring \"" << line << "\"";
+			continue;
+		}
+
+		const bool orEqual = pos + 1 < line.size() && line[pos + 1] == '=';
+		Operator op;
+		switch(line[pos])
+		{
+			case '<': op = orEqual ? OP_LESS_EQUAL : OP_LESS; break;
+			case '>': op = orEqual ? OP_GREATER_EQUAL : OP_GREATER; break;
+			case '!': op = OP_NOT_EQUAL; break;
+			default: op = OP_EQUAL; break;
+		}
+
+		if(line[pos] == '!' && !orEqual)
+		{
+			LOG(LogWarning) << "Smart collection query " << path << ":" << lineNumber << ": unknown operator, ignoring \"" << line << "\"";
+			continue;
+		}
+
+		std::string key = boost::trim_copy(line.substr(0, pos));
+		std::string value = boost::trim_copy(line.substr(pos + (orEqual ? 2 : 1)));
+		strToUpper(value);
+
+		MetaDataId id = getMetaDataId(key);
+		const MetaDataDecl* decl = NULL;
+		for(auto it = mdd.begin(); it != mdd.end(); it++)
+		{
+			if(it->key == key)
+				decl = &(*it);
+		}
+
+		if(id == META_COUNT || !decl)
+		{
+			LOG(LogWarning) << "Smart collection query " << path << ":" << lineNumber << ": games have no \"" << key << "\", ignoring the line";
+			continue;
+		}
+
+		// '=' on a key again is another value it may have
+		if(op == OP_EQUAL)
+		{
+			bool merged = false;
+			for(auto it = mConditions.begin(); it != mConditions.end() && !merged; it++)
+			{
+				if(it->id == id && it->op == OP_EQUAL)
+				{
+					it->values.push_back(value);
+					merged = true;
+				}
+			}
+
+			if(merged)
+				continue;
+		}
+
+		Condition condition;
+		condition.id = id;
+		condition.type = decl->type;
+		condition.op = op;
+		condition.values.push_back(value);
+
+		condition.indexType = NONE;
+		if(op == OP_EQUAL)
+		{
+			switch(id)
+			{
+				case META_GENRE: condition.indexType = GENRE_FILTER; break;
+				case META_PLAYERS: condition.indexType = PLAYER_FILTER; break;
+				case META_FAVORITE: condition.indexType = FAVORITES_FILTER; break;
+				default: break;
+			}
+		}
+
+		mConditions.push_back(condition);
+	}
+
+	if(mConditions.empty())
+	{
+		LOG(LogError) << "Smart collection query " << path << " has no conditions";
+		return false;
+	}
+
+	return true;
+}
+
+bool SmartCollectionQuery::isMet(int comparison, Operator op)
+{
+	switch(op)
+	{
+		case OP_EQUAL: return comparison == 0;
+		case OP_NOT_EQUAL: return comparison != 0;
+		case OP_LESS: return comparison < 0;
+		case OP_LESS_EQUAL: return comparison <= 0;
+		case OP_GREATER: return comparison > 0;
+		case OP_GREATER_EQUAL: return comparison >= 0;
+	}
+	return false;
+}
+
+bool SmartCollectionQuery::matches(FileData* game, const Condition& condition) const
+{
+	// the same keys the filters see, a genre of "Shooter/Vertical" is also a "Shooter"
+	if(condition.indexType != NONE)
+	{
+		FileFilterIndex* index = game->getSystem()->getIndex();
+		for(auto it = condition.values.begin(); it != condition.values.end(); it++)
+		{
+			if(index->hasKey(game, condition.indexType, *it))
+				return true;
+		}
+		return false;
+	}
+
+	switch(condition.type)
+	{
+		case MD_INT:
+		case MD_FLOAT:
+		case MD_RATING:
+		{
+			double number = (condition.type == MD_INT) ? game->metadata.getInt(condition.id) : game->metadata.getFloat(condition.id);
+			for(auto it = condition.values.begin(); it != condition.values.end(); it++)
+			{
+				double wanted = atof(it->c_str());
+				if(isMet((number < wanted) ? -1 : (number > wanted) ? 1 : 0, condition.op))
+					return true;
+			}
+			return false;
+		}
+
+		case MD_DATE:
+		case MD_TIME:
+		{
+			// "19950824T000000", only compared as far as the query's value goes, so "1995" is all of that year
+			std::string date = game->metadata.get(condition.id);
+			if(date.empty() || !isdigit((unsigned char)date[0]))
+				return false;
+
+			for(auto it = condition.values.begin(); it != condition.values.end(); it++)
+			{
+				if(isMet(date.compare(0, it->size(), *it), condition.op))
+					return true;
+			}
+			return false;
+		}
+
+		default:
+		{
+			std::string text = game->metadata.get(condition.id);
+			strToUpper(text);
+			for(auto it = condition.values.begin(); it != condition.values.end(); it++)
+			{
+				if(isMet(text.compare(*it), condition.op))
+					return true;
+			}
+			return false;
+		}
+	}
+}
+
+bool SmartCollectionQuery::matches(FileData* game) const
+{
+	if(game->getType() != GAME)
+		return false;
+
+	for(auto it = mConditions.begin(); it != mConditions.end(); it++)
+	{
+		if(!matches(game, *it))
+			return false;
+	}
+	return true;
+}
+
+void SmartCollectionQuery::getMatchingGames(SystemData* system, std::vector<FileData*>& out) const
+{
+	std::map< FilterIndexType, std::vector<std::string> > keys;
+	for(auto it = mConditions.begin(); it != mConditions.end(); it++)
+	{
+		if(it->indexType != NONE)
+			keys[it->indexType] = it->values;
+	}
+
+	if(keys.empty())
+	{
+		for(auto it = system->getGames().begin(); it != system->getGames().end(); it++)
+		{
+			if(matches(*it))
+				out.push_back(*it);
+		}
+		return;
+	}
+
+	std::vector<FileData*> candidates;
+	system->getIndex()->getCandidates(system->getGames(), keys, candidates);
+	for(auto it = candidates.begin(); it != candidates.end(); it++)
+	{
+		if(matches(*it))
+			out.push_back(*it);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include "MetaData.h"
+#include "FileFilterIndex.h"
+
+class FileData;
+class SystemData;
+
+// What a smart collection holds, read from smart-<name>.cfg in the collections folder. One condition per line,
+// a game has to meet all of them:
+//   genre = Shooter
+//   players >= 2
+//   rating >= 0.7
+//   releasedate < 1995
+// Several '=' lines for the same key mean any of those values will do. Dates are compared as far as the
+// value goes, so a year is enough. Lines starting with '#' are comments.
+class SmartCollectionQuery
+{
+public:
+	SmartCollectionQuery();
+
+	// returns false if the file can't be read or has no valid conditions
+	bool load(const std::string& path);
+
+	bool matches(FileData* game) const;
+
+	// Every game of the system that matches. Keys the filter index knows (genre, players, favorite) are looked
+	// up in its bitmaps first, so only the games that have them are checked.
+	void getMatchingGames(SystemData* system, std::vector<FileData*>& out) const;
+
+private:
+	enum Operator
+	{
+		OP_EQUAL,
+		OP_NOT_EQUAL,
+		OP_LESS,
+		OP_LESS_EQUAL,
+		OP_GREATER,
+		OP_GREATER_EQUAL
+	};
+
+	struct Condition
+	{
+		MetaDataId id;
+		MetaDataType type;
+		FilterIndexType indexType; // NONE unless an OP_EQUAL the filter index can answer
+		Operator op;
+		std::vector<std::string> values; // upper case; only OP_EQUAL has more than one
+	};
+
+	bool matches(FileData* game, const Condition& condition) const;
+	static bool isMet(int comparison, Operator op); // comparison is <0, 0 or >0, like strcmp's
+
+	std::vector<Condition> mConditions;
+};
@@ -0,0 +1,69 @@
+#include "StringPool.h"
+#include "Log.h"
+#include <algorithm>
+#include <cctype>
+
+#define NO_UPPER_ID ((StringPool::Id)-1)
+
+StringPool* StringPool::getInstance()
+{
+	// every loader thread interns while parsing its gamelist, C++11 makes this initialization thread-safe
+	static StringPool* instance = new StringPool();
+	return instance;
+}
+
+StringPool::StringPool() : mCount(0)
+{
+	for(unsigned int i = 0; i < MAX_CHUNKS; i++)
+		mChunks[i] = NULL;
+
+	intern("");
+}
+
+StringPool::Id StringPool::intern(const std::string& str)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mIds.find(str);
+	if(it != mIds.end())
+		return it->second;
+
+	if(mCount >= CHUNK_SIZE * MAX_CHUNKS)
+	{
+		LOG(LogError) << "String pool is full, \"" << str << "\" is treated as an empty string";
+		return EMPTY;
+	}
+
+	Id id = mCount;
+	Entry*& chunk = mChunks[id >> CHUNK_BITS];
+	if(chunk == NULL)
+		chunk = new Entry[CHUNK_SIZE];
+
+	it = mIds.insert(std::make_pair(str, id)).first;
+	chunk[id & (CHUNK_SIZE - 1)].str = &it->first;
+	chunk[id & (CHUNK_SIZE - 1)].upper = NO_UPPER_ID;
+	mCount++;
+
+	return id;
+}
+
+const std::string& StringPool::get(Id id) const
+{
+	return *mChunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)].str;
+}
+
+StringPool::Id StringPool::getUpperId(Id id)
+{
+	Entry& entry = mChunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+
+	Id upper = entry.upper;
+	if(upper == NO_UPPER_ID)
+	{
+		std::string str = *entry.str;
+		std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+		upper = intern(str);
+		entry.upper = upper;
+	}
+
+	return upper;
+}
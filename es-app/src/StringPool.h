@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+
+// Keeps one copy of every string handed to intern() and gives it a stable id, so values repeated over
+// thousands of games (developers, genres...) are stored once and can be compared as integers.
+// Interning is safe from any thread; get() never locks.
+class StringPool
+{
+public:
+	typedef unsigned int Id;
+
+	static const Id EMPTY = 0; // "" always has id 0
+
+	static StringPool* getInstance();
+
+	Id intern(const std::string& str);
+	const std::string& get(Id id) const;
+
+	// the id of the upper case version of the string, worked out once
+	Id getUpperId(Id id);
+
+private:
+	struct Entry
+	{
+		const std::string* str; // the key in mIds, which never moves
+		std::atomic<Id> upper;
+	};
+
+	static const unsigned int CHUNK_BITS = 12;
+	static const unsigned int CHUNK_SIZE = 1 << CHUNK_BITS;
+	static const unsigned int MAX_CHUNKS = 4096;
+
+	StringPool();
+
+	std::unordered_map<std::string, Id> mIds;
+	Entry* mChunks[MAX_CHUNKS]; // allocated as needed and never freed or moved, so get() can read them without the lock
+	Id mCount;
+	std::mutex mMutex;
+};
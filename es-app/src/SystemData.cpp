@@ -10,27 +10,100 @@
 #include <iostream>
 #include "Settings.h"
 #include "FileSorts.h"
+#include "ScanCache.h"
+#include "RomScanner.h"
+#include "LibraryWatcher.h"
+#include "GamelistSaver.h"
+#include "PlayStatsJournal.h"
+#include "SearchIndex.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 std::vector<SystemData*> SystemData::sSystemVector;
 
 namespace fs = boost::filesystem;
 
+// systems are declared first and built afterwards, so the directory scans can run in parallel
+struct SystemDecl
+{
+	std::string name;
+	std::string fullName;
+	SystemEnvironmentData* envData;
+	std::string themeFolder;
+};
+
+// systems from es_systems.cfg that are still being built in the background, see beginLoadConfig()
+struct SystemLoader
+{
+	std::vector<SystemDecl> decls;
+	std::vector<SystemData*> systems; // filled in by the loader threads
+	unsigned int nextDecl; // next declaration to be claimed by a loader thread
+	unsigned int loadedCount;
+	unsigned int nextAdded; // next system to be moved into sSystemVector
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable systemLoaded;
+};
+
+static SystemLoader* sLoader = NULL;
+static std::atomic<unsigned int> sLoadedGames(0);
+
+// worker pool, each thread picks the next unclaimed declaration
+static void loadSystems(SystemLoader* loader)
+{
+	std::unique_lock<std::mutex> lock(loader->mutex);
+	while(loader->nextDecl < loader->decls.size())
+	{
+		unsigned int i = loader->nextDecl++;
+		const SystemDecl& decl = loader->decls.at(i);
+		lock.unlock();
+
+		SystemData* system = new SystemData(decl.name, decl.fullName, decl.envData, decl.themeFolder);
+
+		lock.lock();
+		loader->systems[i] = system;
+		loader->loadedCount++;
+		loader->systemLoaded.notify_all();
+	}
+}
+
 SystemData::SystemData(const std::string& name, const std::string& fullName, SystemEnvironmentData* envData, const std::string& themeFolder, bool CollectionSystem) :
-	mName(name), mFullName(fullName), mEnvData(envData), mThemeFolder(themeFolder), mIsCollectionSystem(CollectionSystem), mIsGameSystem(true)
+	mName(name), mFullName(fullName), mEnvData(envData), mThemeFolder(themeFolder), mIsCollectionSystem(CollectionSystem), mIsGameSystem(true),
+	mDisplayedGamesValid(false), mDisplayedGamesGeneration(0), mDisplayedTreeGeneration(0), mGameCount(0), mGameCountValid(false), mGameCountTreeGeneration(0), mInSearchIndex(false)
 {
 	mFilterIndex = new FileFilterIndex();
 
 	// if it's an actual system, initialize it, if not, just create the data structure
 	if(!CollectionSystem)
 	{
-		mRootFolder = new FileData(FOLDER, mEnvData->mStartPath, mEnvData, this);
+		mRootFolder = new (mFileArena) FileData(FOLDER, mEnvData->mStartPath, mEnvData, this);
 		mRootFolder->metadata.set("name", mFullName);
 
 		if(!Settings::getInstance()->getBool("ParseGamelistOnly"))
-			populateFolder(mRootFolder);
+		{
+			RomScanner scanner(mEnvData->mSearchExtensions, Settings::getInstance()->getBool("CaseInsensitiveExtensions"));
+			const std::string rootPath = mRootFolder->getPath().generic_string();
+
+			// on network mounts every listing is a round trip, so optionally overlap them first
+			int scanThreads = Settings::getInstance()->getInt("ScanThreads");
+			if(scanThreads > 1)
+				scanner.prefetch(rootPath, scanThreads);
+
+			populateFolder(mRootFolder, rootPath, scanner);
+			scanner.logStats(mName);
+
+			// found on the loader thread, the main thread only adds the watches
+			if(Settings::getInstance()->getBool("WatchLibrary"))
+				mScannedFolders.swap(scanner.getOpenedFolders());
+		}
 
 		if(!Settings::getInstance()->getBool("IgnoreGamelist"))
+		{
 			parseGamelist(this);
+			PlayStatsJournal::replay(this);
+		}
 
 		mRootFolder->sort(FileSorts::SortTypes.at(0));
 	}
@@ -40,7 +113,16 @@ SystemData::SystemData(const std::string& name, const std::string& fullName, Sys
 		mRootFolder = new FileData(FOLDER, "" + name, mEnvData, this);
 	}
 	setIsGameSystemStatus();
-	loadTheme();
+
+	if(!CollectionSystem && mIsGameSystem)
+	{
+		SearchIndex::getInstance()->addSystem(this);
+		mInSearchIndex = true;
+	}
+
+	// game systems may be built on a loader thread, loadConfig() loads their theme once they're joined
+	if(CollectionSystem)
+		loadTheme();
 }
 
 SystemData::~SystemData()
@@ -48,10 +130,21 @@ SystemData::~SystemData()
 	//save changed game data back to xml
 	if(!Settings::getInstance()->getBool("IgnoreGamelist") && Settings::getInstance()->getBool("SaveGamelistsOnExit") && !mIsCollectionSystem)
 	{
-		updateGamelist(this);
+		GamelistSaver::getInstance()->markDirty(this);
 	}
 
-	delete mRootFolder;
+	// the changes are taken now, the file is written later by the saver
+	GamelistSaver::getInstance()->flushSystem(this);
+
+	if(mInSearchIndex)
+		SearchIndex::getInstance()->removeSystem(this);
+
+	// a game system's tree goes in one walk and its memory with the arena; collection systems can hold
+	// the root folders of other collections, so they're left to delete as before
+	if(mIsCollectionSystem)
+		delete mRootFolder;
+	else
+		mRootFolder->deleteTree();
 	delete mFilterIndex;
 }
 
@@ -63,88 +156,99 @@ void SystemData::setIsGameSystemStatus()
 	mIsGameSystem = (mName != "retropie");
 }
 
-#ifndef WIN32
-// test to see if a file is hidden in *nix (dot-prefixed)
-// could be expanded to check for Windows hidden attribute
-bool isHidden(const fs::path &filePath)
+void SystemData::populateFolder(FileData* folder, const std::string& folderStr, RomScanner& scanner)
 {
-	fs::path::string_type fileName = filePath.filename().string();
-	if(fileName[0] == '.')
+	//make sure this is a folder, and not a symlink to one we already have
+	std::vector<ScanCache::Entry> entries;
+	if(!scanner.openFolder(folderStr, entries))
+		return;
+
+	scanner.addScannedEntries(entries.size());
+
+	bool showHidden = Settings::getInstance()->getBool("ShowHiddenFiles");
+	for(auto it = entries.begin(); it != entries.end(); it++)
 	{
-		return true;
+		FileData* file = createFile(folderStr + "/" + it->name, it->name, it->isDirectory, scanner, showHidden);
+		if(file == NULL)
+			continue;
+
+		folder->addChild(file);
+		if(file->getType() == GAME)
+			sLoadedGames++;
 	}
 
-	return false;
+	scanner.closeFolder();
 }
-#endif
 
-void SystemData::populateFolder(FileData* folder)
+FileData* SystemData::createFile(const std::string& filePath, const std::string& fileName, bool isDirectory, RomScanner& scanner, bool showHidden)
 {
-	const fs::path& folderPath = folder->getPath();
-	if(!fs::is_directory(folderPath))
-	{
-		LOG(LogWarning) << "Error - folder with path \"" << folderPath << "\" is not a directory!";
-		return;
-	}
+	if(RomScanner::isStemless(fileName))
+		return NULL;
+
+	//this is a little complicated because we allow a list of extensions to be defined (delimited with a space)
+	//the scanner hashes that list, so we only need to look up the extension of the file itself
 
-	const std::string folderStr = folderPath.generic_string();
+	//fyi, folders *can* also match the extension and be added as games - this is mostly just to support higan
+	//see issue #75: https://github.com/Aloshi/EmulationStation/issues/75
 
-	//make sure that this isn't a symlink to a thing we already have
-	if(fs::is_symlink(folderPath))
+	if(scanner.matchesExtension(fileName))
 	{
-		//if this symlink resolves to somewhere that's at the beginning of our path, it's gonna recurse
-		if(folderStr.find(fs::canonical(folderPath).generic_string()) == 0)
-		{
-			LOG(LogWarning) << "Skipping infinitely recursive symlink \"" << folderPath << "\"";
-			return;
-		}
+#ifndef WIN32
+		// skip hidden files (dot-prefixed)
+		if(!showHidden && fileName[0] == '.')
+			return NULL;
+#endif
+
+		return new (mFileArena) FileData(GAME, fileName, this);
 	}
 
-	fs::path filePath;
-	std::string extension;
-	bool isGame;
-	bool showHidden = Settings::getInstance()->getBool("ShowHiddenFiles");
-	for(fs::directory_iterator end, dir(folderPath); dir != end; ++dir)
+	//add directories that also do not match an extension as folders
+	if(!isDirectory)
+		return NULL;
+
+	// not in the tree yet, so it can't tell its path itself
+	FileData* folder = new (mFileArena) FileData(FOLDER, fileName, this);
+	populateFolder(folder, filePath, scanner);
+
+	//ignore folders that do not contain games
+	if(folder->getChildrenByFilename().size() == 0)
 	{
-		filePath = (*dir).path();
+		delete folder;
+		return NULL;
+	}
 
-		if(filePath.stem().empty())
-			continue;
+	return folder;
+}
 
-		//this is a little complicated because we allow a list of extensions to be defined (delimited with a space)
-		//we first get the extension of the file itself:
-		extension = filePath.extension().string();
+FileData* SystemData::findFile(const std::string& relativePath, FileData** deepest, size_t* missingStart) const
+{
+	FileData* file = mRootFolder;
+	size_t start = 0;
 
-		//fyi, folders *can* also match the extension and be added as games - this is mostly just to support higan
-		//see issue #75: https://github.com/Aloshi/EmulationStation/issues/75
+	// walk down from the root, one path component at a time
+	while(start < relativePath.size())
+	{
+		size_t end = std::min(relativePath.find('/', start), relativePath.size());
+		auto it = file->getChildrenByFilename().find(relativePath.substr(start, end - start));
+		if(it == file->getChildrenByFilename().end())
+			break;
 
-		isGame = false;
-		if(std::find(mEnvData->mSearchExtensions.begin(), mEnvData->mSearchExtensions.end(), extension) != mEnvData->mSearchExtensions.end())
-		{
-#ifndef WIN32
-			// skip hidden files
-			if(!showHidden && isHidden(filePath))
-				continue;
-#endif
+		file = it->second;
+		start = end + 1;
+	}
 
-			FileData* newGame = new FileData(GAME, filePath.generic_string(), mEnvData, this);
-			folder->addChild(newGame);
-			isGame = true;
-		}
+	if(deepest != NULL)
+		*deepest = file;
+	if(missingStart != NULL)
+		*missingStart = start;
 
-		//add directories that also do not match an extension as folders
-		if(!isGame && fs::is_directory(filePath))
-		{
-			FileData* newFolder = new FileData(FOLDER, filePath.generic_string(), mEnvData, this);
-			populateFolder(newFolder);
+	return (start >= relativePath.size()) ? file : NULL;
+}
 
-			//ignore folders that do not contain games
-			if(newFolder->getChildrenByFilename().size() == 0)
-				delete newFolder;
-			else
-				folder->addChild(newFolder);
-		}
-	}
+FileData* SystemData::createFileData(const std::string& path, bool isDirectory)
+{
+	RomScanner scanner(mEnvData->mSearchExtensions, Settings::getInstance()->getBool("CaseInsensitiveExtensions"));
+	return createFile(path, fs::path(path).filename().generic_string(), isDirectory, scanner, Settings::getInstance()->getBool("ShowHiddenFiles"));
 }
 
 std::vector<std::string> readList(const std::string& str, const char* delims = " \t\r\n,")
@@ -166,6 +270,17 @@ std::vector<std::string> readList(const std::string& str, const char* delims = "
 
 //creates systems from information located in a config file
 bool SystemData::loadConfig()
+{
+	if(!beginLoadConfig())
+		return false;
+
+	while(isLoadingSystems())
+		updateLoadedSystems(true);
+
+	return true;
+}
+
+bool SystemData::beginLoadConfig()
 {
 	deleteSystems();
 
@@ -199,6 +314,12 @@ bool SystemData::loadConfig()
 		return false;
 	}
 
+	sLoader = new SystemLoader();
+	sLoader->nextDecl = 0;
+	sLoader->loadedCount = 0;
+	sLoader->nextAdded = 0;
+	sLoadedGames = 0;
+
 	for(pugi::xml_node system = systemList.child("system"); system; system = system.next_sibling("system"))
 	{
 		std::string name, fullname, path, cmd, themeFolder;
@@ -265,20 +386,131 @@ bool SystemData::loadConfig()
 		envData->mLaunchCommand = cmd;
 		envData->mPlatformIds = platformIds;
 
-		SystemData* newSys = new SystemData(name, fullname, envData, themeFolder);
+		SystemDecl decl = { name, fullname, envData, themeFolder };
+		sLoader->decls.push_back(decl);
+	}
+
+	sLoader->systems.resize(sLoader->decls.size(), NULL);
+
+	// read the scan manifest up front, rather than racing to create it from the loader threads
+	ScanCache::getInstance();
+
+	// there's always at least one loader thread, so the main thread is free to show the systems as they come in
+	int maxThreads = Settings::getInstance()->getInt("SystemLoadThreads");
+	unsigned int threadCount = (unsigned int)std::min<size_t>(maxThreads > 1 ? maxThreads : 1, sLoader->decls.size());
+	LOG(LogInfo) << "Loading " << sLoader->decls.size() << " systems using " << threadCount << " threads...";
+
+	for(unsigned int i = 0; i < threadCount; i++)
+		sLoader->threads.push_back(std::thread(loadSystems, sLoader));
+
+	// nothing to wait for, finish right away
+	if(sLoader->decls.empty())
+		updateLoadedSystems(false);
+
+	return true;
+}
+
+bool SystemData::updateLoadedSystems(bool wait)
+{
+	if(sLoader == NULL)
+		return false;
+
+	bool changed = false;
+	std::unique_lock<std::mutex> lock(sLoader->mutex);
+	while(sLoader->nextAdded < sLoader->systems.size())
+	{
+		// keep the order of es_systems.cfg, a system is only added once all the ones before it are
+		SystemData* newSys = sLoader->systems.at(sLoader->nextAdded);
+		if(newSys == NULL)
+		{
+			if(!wait || changed)
+				break;
+
+			sLoader->systemLoaded.wait(lock);
+			continue;
+		}
+
+		sLoader->nextAdded++;
+		lock.unlock();
+
 		if(newSys->getRootFolder()->getChildrenByFilename().size() == 0)
 		{
-			LOG(LogWarning) << "System \"" << name << "\" has no games! Ignoring it.";
+			LOG(LogWarning) << "System \"" << newSys->getName() << "\" has no games! Ignoring it.";
 			delete newSys;
 		}else{
+			// themes are loaded here since they aren't safe to load off the main thread
+			newSys->loadTheme();
 			sSystemVector.push_back(newSys);
+			changed = true;
+
+			if(Settings::getInstance()->getBool("WatchLibrary"))
+				LibraryWatcher::getInstance()->watchSystem(newSys);
 		}
+
+		lock.lock();
 	}
+
+	if(sLoader->nextAdded < sLoader->systems.size())
+		return changed;
+
+	lock.unlock();
+	for(auto it = sLoader->threads.begin(); it != sLoader->threads.end(); it++)
+		it->join();
+
+	delete sLoader;
+	sLoader = NULL;
+
+	LOG(LogInfo) << "Loaded " << sSystemVector.size() << " systems with " << sLoadedGames << " games";
+
+	// remember what was scanned, so unchanged folders can be skipped next time
+	ScanCache::getInstance()->save();
+
+	// collections are built from every loaded system, so they wait for all of them
 	CollectionSystemManager::get()->loadCollectionSystems();
 
 	return true;
 }
 
+bool SystemData::isLoadingSystems()
+{
+	return sLoader != NULL;
+}
+
+void SystemData::getLoadingProgress(unsigned int* loadedSystems, unsigned int* totalSystems, unsigned int* loadedGames)
+{
+	*loadedGames = sLoadedGames;
+	if(sLoader == NULL)
+	{
+		*loadedSystems = *totalSystems = (unsigned int)sSystemVector.size();
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(sLoader->mutex);
+	*loadedSystems = sLoader->loadedCount;
+	*totalSystems = (unsigned int)sLoader->decls.size();
+}
+
+void SystemData::cancelLoading()
+{
+	if(sLoader == NULL)
+		return;
+
+	// let the threads finish the systems they're on, but don't start any new ones
+	{
+		std::unique_lock<std::mutex> lock(sLoader->mutex);
+		sLoader->nextDecl = (unsigned int)sLoader->decls.size();
+	}
+
+	for(auto it = sLoader->threads.begin(); it != sLoader->threads.end(); it++)
+		it->join();
+
+	for(unsigned int i = sLoader->nextAdded; i < sLoader->systems.size(); i++)
+		delete sLoader->systems.at(i);
+
+	delete sLoader;
+	sLoader = NULL;
+}
+
 void SystemData::writeExampleConfig(const std::string& path)
 {
 	std::ofstream file(path.c_str());
@@ -327,11 +559,17 @@ void SystemData::writeExampleConfig(const std::string& path)
 
 void SystemData::deleteSystems()
 {
+	cancelLoading();
+	LibraryWatcher::getInstance()->unwatchAll();
+
 	for(unsigned int i = 0; i < sSystemVector.size(); i++)
 	{
 		delete sSystemVector.at(i);
 	}
 	sSystemVector.clear();
+
+	// wait for the gamelists, they're written in parallel
+	GamelistSaver::getInstance()->flush();
 }
 
 std::string SystemData::getConfigPath(bool forWrite)
@@ -391,7 +629,84 @@ bool SystemData::hasGamelist() const
 
 unsigned int SystemData::getGameCount() const
 {
-	return mRootFolder->getFilesRecursive(GAME).size();
+	if(mRootFolder->linksChildren())
+		return mRootFolder->getChildren().size();
+
+	if(!holdsOtherSystems())
+		return mGames.size();
+
+	// the bundle's collections add, remove and change their games through childrenChanged, which reaches our root
+	if(!mGameCountValid || mGameCountTreeGeneration != mRootFolder->mChildrenGeneration)
+	{
+		mGameCount = mRootFolder->getFilesRecursive(GAME).size();
+		mGameCountValid = true;
+		mGameCountTreeGeneration = mRootFolder->mChildrenGeneration;
+	}
+
+	return mGameCount;
+}
+
+// the custom collections bundle has no games of its own, it shows the root folders of other collections;
+// a collection that links to games shows those of the game systems
+bool SystemData::holdsOtherSystems() const
+{
+	return mGames.empty() && !mRootFolder->getChildren().empty() && mRootFolder->getChildren().front()->getSystem() != this;
+}
+
+void SystemData::addGame(FileData* game)
+{
+	game->mSystemGameIndex = mGames.size();
+	mGames.push_back(game);
+	mDisplayedGamesValid = false;
+
+	if(mInSearchIndex)
+		SearchIndex::getInstance()->addGame(game);
+}
+
+void SystemData::removeGame(FileData* game)
+{
+	// the last game takes its place, so nothing has to be searched or moved
+	FileData* last = mGames.back();
+	mGames[game->mSystemGameIndex] = last;
+	last->mSystemGameIndex = game->mSystemGameIndex;
+	mGames.pop_back();
+	mDisplayedGamesValid = false;
+
+	if(mInSearchIndex)
+		SearchIndex::getInstance()->removeGame(game);
+}
+
+const std::vector<FileData*>& SystemData::getDisplayedGames() const
+{
+	// a collection linking to games lists them right below its root, the bundle has to go through its collections
+	const bool linked = mRootFolder->linksChildren();
+	const bool bundle = !linked && holdsOtherSystems();
+	const std::vector<FileData*>& games = linked ? mRootFolder->getChildren() : mGames;
+
+	if(!bundle && !mFilterIndex->isFiltered())
+		return games;
+
+	// games coming, going or changing their metadata bump the root's generation through childrenChanged
+	if(!mDisplayedGamesValid || mDisplayedGamesGeneration != mFilterIndex->getGeneration() || mDisplayedTreeGeneration != mRootFolder->mChildrenGeneration)
+	{
+		if(bundle)
+		{
+			mDisplayedGames = mRootFolder->getFilesRecursive(GAME, true);
+		}else{
+			mDisplayedGames.clear();
+			for(auto it = games.begin(); it != games.end(); it++)
+			{
+				if(mFilterIndex->showFile(*it))
+					mDisplayedGames.push_back(*it);
+			}
+		}
+
+		mDisplayedGamesValid = true;
+		mDisplayedGamesGeneration = mFilterIndex->getGeneration();
+		mDisplayedTreeGeneration = mRootFolder->mChildrenGeneration;
+	}
+
+	return mDisplayedGames;
 }
 
 SystemData* SystemData::getRandomSystem()
@@ -424,7 +739,7 @@ SystemData* SystemData::getRandomSystem()
 
 FileData* SystemData::getRandomGame()
 {
-	std::vector<FileData*> list = mRootFolder->getFilesRecursive(GAME, true);
+	const std::vector<FileData*>& list = getDisplayedGames();
 	unsigned int total = list.size();
 	int target = 0;
 	// get random number in range
@@ -436,7 +751,7 @@ FileData* SystemData::getRandomGame()
 
 unsigned int SystemData::getDisplayedGameCount() const
 {
-	return mRootFolder->getFilesRecursive(GAME, true).size();
+	return getDisplayedGames().size();
 }
 
 void SystemData::loadTheme()
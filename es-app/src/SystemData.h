@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include "FileData.h"
+#include "FileArena.h"
 #include "Window.h"
 #include "MetaData.h"
 #include "PlatformId.h"
@@ -10,6 +11,8 @@
 #include "FileFilterIndex.h"
 #include "CollectionSystemManager.h"
 
+class RomScanner;
+
 struct SystemEnvironmentData
 {
 	std::string mStartPath;
@@ -25,6 +28,7 @@ public:
 	~SystemData();
 
 	inline FileData* getRootFolder() const { return mRootFolder; };
+	inline FileArena& getFileArena() { return mFileArena; }
 	inline const std::string& getName() const { return mName; }
 	inline const std::string& getFullName() const { return mFullName; }
 	inline const std::string& getStartPath() const { return mEnvData->mStartPath; }
@@ -43,8 +47,23 @@ public:
 	unsigned int getGameCount() const;
 	unsigned int getDisplayedGameCount() const;
 
+	// Every game of the system in no particular order, kept up to date by FileData as games come and go.
+	inline const std::vector<FileData*>& getGames() const { return mGames; }
+	// The games the filters let through, only worked out again once the filters or the games have changed.
+	const std::vector<FileData*>& getDisplayedGames() const;
+	void addGame(FileData* game);
+	void removeGame(FileData* game);
+
 	static void deleteSystems();
 	static bool loadConfig(); //Load the system config file at getConfigPath(). Returns true if no errors were encountered. An example will be written if the file doesn't exist.
+
+	// Same as loadConfig(), but the systems are built in the background. Call updateLoadedSystems() from the main
+	// thread to move the finished ones into sSystemVector, in es_systems.cfg order. Collections are loaded once they're all in.
+	static bool beginLoadConfig();
+	static bool updateLoadedSystems(bool wait); // returns true if sSystemVector changed; if wait, blocks until it does or loading is over
+	static bool isLoadingSystems();
+	static void getLoadingProgress(unsigned int* loadedSystems, unsigned int* totalSystems, unsigned int* loadedGames);
+	static void cancelLoading();
 	static void writeExampleConfig(const std::string& path);
 	static std::string getConfigPath(bool forWrite); // if forWrite, will only return ~/.emulationstation/es_systems.cfg, never /etc/emulationstation/es_systems.cfg
 
@@ -78,6 +97,18 @@ public:
 
 	FileFilterIndex* getIndex() { return mFilterIndex; };
 
+	// Builds the FileData for a file that showed up after loading, following the same rules as the initial scan.
+	// Returns NULL if it's neither a game nor a folder with games in it. The node only gets its path once it's added to a folder.
+	FileData* createFileData(const std::string& path, bool isDirectory);
+
+	// The file at a path relative to the root folder, "/" separated, or NULL if it isn't there. If deepest isn't NULL
+	// it gets the last file that was found on the way, and missingStart where the first missing component starts.
+	FileData* findFile(const std::string& relativePath, FileData** deepest = NULL, size_t* missingStart = NULL) const;
+
+	// The folders the scan listed, so LibraryWatcher can watch them without listing them again. Only kept
+	// if WatchLibrary is set, and handed over once: out is empty if there was no scan or they were taken.
+	inline void takeScannedFolders(std::vector<std::string>& out) { out.swap(mScannedFolders); mScannedFolders.clear(); }
+
 private:
 	bool mIsCollectionSystem;
 	bool mIsGameSystem;
@@ -87,10 +118,24 @@ private:
 	std::string mThemeFolder;
 	std::shared_ptr<ThemeData> mTheme;
 
-	void populateFolder(FileData* folder);
+	void populateFolder(FileData* folder, const std::string& folderStr, RomScanner& scanner);
+	FileData* createFile(const std::string& filePath, const std::string& fileName, bool isDirectory, RomScanner& scanner, bool showHidden); // for one folder entry, NULL if it's left out
 	void setIsGameSystemStatus();
+	bool holdsOtherSystems() const;
 
 	FileFilterIndex* mFilterIndex;
 
+	FileArena mFileArena;
 	FileData* mRootFolder;
+
+	std::vector<FileData*> mGames;
+	mutable std::vector<FileData*> mDisplayedGames;
+	mutable bool mDisplayedGamesValid;
+	mutable unsigned int mDisplayedGamesGeneration; // of the filter index, when mDisplayedGames was built
+	mutable unsigned int mDisplayedTreeGeneration; // of the root folder's children, likewise
+	mutable unsigned int mGameCount; // only kept for the custom collections bundle
+	mutable bool mGameCountValid;
+	mutable unsigned int mGameCountTreeGeneration;
+	bool mInSearchIndex; // only once the system is fully loaded, games found before that are added with it
+	std::vector<std::string> mScannedFolders;
 };
@@ -361,13 +361,15 @@ void SystemScreenSaver::pickGameListNode(unsigned long index, const char *nodeNa
 						{
 							// Couldn't find FileData. Going for the full iteration.
 							// iterate on children
-							FileType type = GAME;
-							std::vector<FileData*> allFiles = rootFileData->getFilesRecursive(type);
-							std::vector<FileData*>::iterator itf;  // declare an iterator to a vector of strings
+							const std::vector<FileData*>& allFiles = (*it)->getGames();
+							std::vector<FileData*>::const_iterator itf;  // declare an iterator to a vector of strings
 
 							int i = 0;
+							std::string path;
 							for(itf=allFiles.begin() ; itf < allFiles.end(); itf++,i++ ) {
-								if ((*itf)->getPath() == gamePath)
+								path.clear();
+								(*itf)->appendPath(path);
+								if (path == gamePath)
 								{
 									mCurrentGame = (*itf);
 									break;
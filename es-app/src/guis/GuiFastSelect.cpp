@@ -132,7 +132,7 @@ void GuiFastSelect::updateGameListSort()
 {
 	const FileData::SortType& sort = FileSorts::SortTypes.at(mSortId);
 
-	FileData* root = mGameList->getCursor()->getSystem()->getRootFolder();
+	FileData* root = mGameList->getCursorSystem()->getRootFolder();
 	root->sort(sort); // will also recursively sort children
 
 	// notify that the root folder was sorted
@@ -141,7 +141,7 @@ void GuiFastSelect::updateGameListSort()
 
 void GuiFastSelect::updateGameListCursor()
 {
-	const std::vector<FileData*>& list = mGameList->getCursor()->getParent()->getChildren();
+	const std::vector<FileData*>& list = mGameList->getCursorFolder()->getChildren();
 
 	// only skip by letter when the sort mode is alphabetical
 	const FileData::SortType& sort = FileSorts::SortTypes.at(mSortId);
@@ -184,7 +184,7 @@ void GuiGamelistOptions::openMetaDataEd()
 		};
 	}
 
-	mWindow->pushGui(new GuiMetaDataEd(mWindow, &file->metadata, file->metadata.getMDD(), p, file->getPath().filename().string(),
+	mWindow->pushGui(new GuiMetaDataEd(mWindow, &file->metadata, file->metadata.getMDD(), p, file->getFileName(),
 		std::bind(&IGameListView::onFileChanged, ViewController::get()->getGameListView(file->getSystem()).get(), file, FILE_METADATA_CHANGED), deleteBtnFunc));
 }
 
@@ -194,7 +194,7 @@ void GuiGamelistOptions::jumpToLetter()
 	IGameListView* gamelist = getGamelist();
 
 	// this is a really shitty way to get a list of files
-	const std::vector<FileData*>& files = gamelist->getCursor()->getParent()->getChildren();
+	const std::vector<FileData*>& files = gamelist->getCursorFolder()->getChildren();
 
 	long min = 0;
 	long max = files.size() - 1;
@@ -10,6 +10,7 @@
 #include "guis/GuiGeneralScreensaverOptions.h"
 #include "guis/GuiCollectionSystemsOptions.h"
 #include "guis/GuiScraperStart.h"
+#include "guis/GuiSearch.h"
 #include "guis/GuiDetectDevice.h"
 #include "views/ViewController.h"
 
@@ -25,6 +26,7 @@ GuiMenu::GuiMenu(Window* window) : GuiComponent(window), mMenu(window, "MAIN MEN
 {
 	// MAIN MENU
 
+	// SEARCH GAMES >
 	// SCRAPER >
 	// SOUND SETTINGS >
 	// UI SETTINGS >
@@ -33,6 +35,9 @@ GuiMenu::GuiMenu(Window* window) : GuiComponent(window), mMenu(window, "MAIN MEN
 
 	// [version]
 
+	addEntry("SEARCH GAMES", 0x777777FF, true,
+		[this] { mWindow->pushGui(new GuiSearch(mWindow)); });
+
 	auto openScrapeNow = [this] { mWindow->pushGui(new GuiScraperStart(mWindow)); };
 	addEntry("SCRAPER", 0x777777FF, true,
 		[this, openScrapeNow] {
@@ -2,7 +2,7 @@
 #include "Renderer.h"
 #include "Log.h"
 #include "views/ViewController.h"
-#include "Gamelist.h"
+#include "GamelistSaver.h"
 #include "PowerSaver.h"
 
 #include "components/TextComponent.h"
@@ -105,7 +105,7 @@ void GuiScraperMulti::doNextSearch()
 
 	// update subtitle
 	ss.str(""); // clear
-	ss << "GAME " << (mCurrentGame + 1) << " OF " << mTotalGames << " - " << strToUpper(mSearchQueue.front().game->getPath().filename().string());
+	ss << "GAME " << (mCurrentGame + 1) << " OF " << mTotalGames << " - " << strToUpper(mSearchQueue.front().game->getFileName());
 	mSubtitle->setText(ss.str());
 
 	mSearchComp->search(mSearchQueue.front());
@@ -116,7 +116,7 @@ void GuiScraperMulti::acceptResult(const ScraperSearchResult& result)
 	ScraperSearchParams& search = mSearchQueue.front();
 
 	search.game->metadata = result.mdl;
-	updateGamelist(search.system);
+	GamelistSaver::getInstance()->markDirty(search.system);
 
 	mSearchQueue.pop();
 	mCurrentGame++;
@@ -0,0 +1,94 @@
+#include "guis/GuiSearch.h"
+#include "guis/GuiTextEditPopup.h"
+#include "views/ViewController.h"
+#include "components/TextComponent.h"
+#include "SearchIndex.h"
+#include "SystemData.h"
+
+#define SEARCH_MAX_RESULTS 50
+
+GuiSearch::GuiSearch(Window* window) : GuiComponent(window),
+	mMenu(window, "SEARCH GAMES")
+{
+	addChild(&mMenu);
+
+	updateResults(mQuery, false);
+
+	mMenu.addButton("BACK", "back", [&] { delete this; });
+
+	mMenu.setPosition((Renderer::getScreenWidth() - mMenu.getSize().x()) / 2, Renderer::getScreenHeight() * 0.15f);
+}
+
+void GuiSearch::openTextEdit()
+{
+	mWindow->pushGui(new GuiTextEditPopup(mWindow, "SEARCH FOR", mQuery,
+		[this](const std::string& query) { mQuery = query; updateResults(mQuery, true); }, false, "SEARCH",
+		[this](const std::string& query) { updateResults(query, false); }));
+}
+
+void GuiSearch::updateResults(const std::string& query, bool selectFirst)
+{
+	mMenu.clearRows();
+
+	ComponentListRow row;
+	row.addElement(std::make_shared<TextComponent>(mWindow, "SEARCH FOR", Font::get(FONT_SIZE_MEDIUM), 0x777777FF), true);
+	row.addElement(std::make_shared<TextComponent>(mWindow, query, Font::get(FONT_SIZE_MEDIUM, FONT_PATH_LIGHT), 0x777777FF), false);
+	row.addElement(makeArrow(mWindow), false);
+	row.makeAcceptInputHandler([this] { openTextEdit(); });
+	mMenu.addRow(row);
+
+	// asks for more than it shows, games of systems that aren't shown or that the filters hide are left out
+	std::vector<SearchIndex::Result> results = SearchIndex::getInstance()->search(query, SEARCH_MAX_RESULTS * 2);
+
+	unsigned int shown = 0;
+	for(auto it = results.begin(); it != results.end() && shown < SEARCH_MAX_RESULTS; it++)
+	{
+		FileData* game = it->game;
+		SystemData* system = game->getSystem();
+		if(system->getIterator() == SystemData::sSystemVector.end())
+			continue;
+		if(system->getIndex()->isFiltered() && !system->getIndex()->showFile(game))
+			continue;
+
+		ComponentListRow resultRow;
+		resultRow.addElement(std::make_shared<TextComponent>(mWindow, strToUpper(game->getName()), Font::get(FONT_SIZE_MEDIUM), 0x777777FF), true);
+		resultRow.addElement(std::make_shared<TextComponent>(mWindow, strToUpper(system->getFullName()), Font::get(FONT_SIZE_SMALL), 0x777777FF), false);
+		resultRow.makeAcceptInputHandler([this, game] { goToGame(game); });
+		mMenu.addRow(resultRow, selectFirst && shown == 0);
+		shown++;
+	}
+}
+
+void GuiSearch::goToGame(FileData* game)
+{
+	Window* window = mWindow;
+	SystemData* system = game->getSystem();
+
+	// this goes too, so nothing below may use it
+	while(window->peekGui() && window->peekGui() != ViewController::get())
+		delete window->peekGui();
+
+	ViewController::get()->goToGameList(system);
+	ViewController::get()->getGameListView(system)->setCursor(game);
+}
+
+bool GuiSearch::input(InputConfig* config, Input input)
+{
+	if(GuiComponent::input(config, input))
+		return true;
+
+	if(config->isMappedTo("b", input) && input.value != 0)
+	{
+		delete this;
+		return true;
+	}
+
+	return false;
+}
+
+std::vector<HelpPrompt> GuiSearch::getHelpPrompts()
+{
+	std::vector<HelpPrompt> prompts = mMenu.getHelpPrompts();
+	prompts.push_back(HelpPrompt("b", "back"));
+	return prompts;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "GuiComponent.h"
+#include "components/MenuComponent.h"
+
+class FileData;
+
+// Finds games in every system by name, developer, publisher or description. The results are updated
+// with every key typed, picking one jumps to it in its gamelist.
+class GuiSearch : public GuiComponent
+{
+public:
+	GuiSearch(Window* window);
+
+	bool input(InputConfig* config, Input input) override;
+	std::vector<HelpPrompt> getHelpPrompts() override;
+
+private:
+	void openTextEdit();
+	void updateResults(const std::string& query, bool selectFirst);
+	void goToGame(FileData* game);
+
+	MenuComponent mMenu;
+	std::string mQuery; // only changes on OK, what is typed before that is just shown
+};
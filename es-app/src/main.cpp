@@ -19,6 +19,8 @@
 #include "PowerSaver.h"
 #include "Settings.h"
 #include "ScraperCmdLine.h"
+#include "LibraryWatcher.h"
+#include "GamelistSaver.h"
 #include <sstream>
 #include <boost/locale.hpp>
 
@@ -139,12 +141,36 @@ bool verifyHomeFolderExists()
 	return true;
 }
 
+void renderLoadingProgress(Window* window)
+{
+	unsigned int loadedSystems, totalSystems, loadedGames;
+	SystemData::getLoadingProgress(&loadedSystems, &totalSystems, &loadedGames);
+
+	std::stringstream ss;
+	ss << "LOADING SYSTEMS " << loadedSystems << "/" << totalSystems << " (" << loadedGames << " GAMES)";
+	window->renderLoadingScreen(ss.str(), totalSystems > 0 ? (float)loadedSystems / totalSystems : 0.0f);
+}
+
 // Returns true if everything is OK,
-bool loadSystemConfigFile(const char** errorString)
+// the other systems keep loading in the background once the first one is in
+bool loadSystemConfigFile(Window* window, const char** errorString)
 {
 	*errorString = NULL;
 
-	if(!SystemData::loadConfig())
+	bool loaded = window != NULL ? SystemData::beginLoadConfig() : SystemData::loadConfig();
+	while(loaded && SystemData::sSystemVector.size() == 0 && SystemData::isLoadingSystems())
+	{
+		if(Settings::getInstance()->getBool("SplashScreen"))
+		{
+			SystemData::updateLoadedSystems(false);
+			renderLoadingProgress(window);
+			SDL_Delay(10);
+		}else{
+			SystemData::updateLoadedSystems(true);
+		}
+	}
+
+	if(!loaded)
 	{
 		LOG(LogError) << "Error while parsing systems configuration file!";
 		*errorString = "IT LOOKS LIKE YOUR SYSTEMS CONFIGURATION FILE HAS NOT BEEN SET UP OR IS INVALID. YOU'LL NEED TO DO THIS BY HAND, UNFORTUNATELY.\n\n"
@@ -252,7 +278,7 @@ int main(int argc, char* argv[])
 	}
 
 	const char* errorMsg = NULL;
-	if(!loadSystemConfigFile(&errorMsg))
+	if(!loadSystemConfigFile(scrape_cmdline ? NULL : &window, &errorMsg))
 	{
 		// something went terribly wrong
 		if(errorMsg == NULL)
@@ -283,7 +309,7 @@ int main(int argc, char* argv[])
 	SDL_JoystickEventState(SDL_DISABLE);
 
 	// preload what we can right away instead of waiting for the user to select it
-	// this makes for no delays when accessing content, but a longer startup time
+	// this makes for no delays when accessing content, systems still loading are preloaded as they come in
 	ViewController::get()->preload();
 
 	//choose which GUI to open depending on if an input configuration already exists
@@ -350,6 +376,9 @@ int main(int argc, char* argv[])
 			ps_time = SDL_GetTicks();
 		}
 
+		// write changed gamelists once they've settled, also while sleeping
+		GamelistSaver::getInstance()->update();
+
 		if(window.isSleeping())
 		{
 			lastTime = SDL_GetTicks();
@@ -365,6 +394,13 @@ int main(int argc, char* argv[])
 		if(deltaTime < 0)
 			deltaTime = 1000;
 
+		// pick up the systems that finished loading in the background since last frame
+		if(SystemData::isLoadingSystems() && SystemData::updateLoadedSystems(false))
+			ViewController::get()->updateSystemList();
+
+		// apply ROMs added or removed since last frame
+		LibraryWatcher::getInstance()->update();
+
 		window.update(deltaTime);
 		window.render();
 		Renderer::swapBuffers();
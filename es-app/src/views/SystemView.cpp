@@ -31,83 +31,110 @@ void SystemView::populate()
 	mEntries.clear();
 
 	for(auto it = SystemData::sSystemVector.begin(); it != SystemData::sSystemVector.end(); it++)
+		addSystem(*it);
+}
+
+void SystemView::updateSystems()
+{
+	// while loading, systems are only appended, so the existing logos can be kept
+	bool appended = mEntries.size() <= SystemData::sSystemVector.size();
+	for(unsigned int i = 0; appended && i < mEntries.size(); i++)
+		appended = mEntries.at(i).object == SystemData::sSystemVector.at(i);
+
+	if(appended)
 	{
-		const std::shared_ptr<ThemeData>& theme = (*it)->getTheme();
+		for(unsigned int i = mEntries.size(); i < SystemData::sSystemVector.size(); i++)
+			addSystem(SystemData::sSystemVector.at(i));
+		return;
+	}
 
-		if(mViewNeedsReload)
-			getViewElements(theme);
+	SystemData* selected = size() > 0 ? getSelected() : NULL;
+	populate();
 
-		Entry e;
-		e.name = (*it)->getName();
-		e.object = *it;
+	if(size() == 0)
+		return;
 
-		// make logo
-		if(theme->getElement("system", "logo", "image"))
-		{
-			std::string path = theme->getElement("system", "logo", "image")->get<std::string>("path");
+	auto it = std::find(SystemData::sSystemVector.begin(), SystemData::sSystemVector.end(), selected);
+	goToSystem(it != SystemData::sSystemVector.end() ? selected : SystemData::sSystemVector.front(), false);
+}
 
-			if(!path.empty() && ResourceManager::getInstance()->fileExists(path))
-			{
-				ImageComponent* logo = new ImageComponent(mWindow, false, false);
-				logo->setMaxSize(mCarousel.logoSize * mCarousel.logoScale);
-				logo->applyTheme((*it)->getTheme(), "system", "logo", ThemeFlags::PATH | ThemeFlags::COLOR);
+void SystemView::addSystem(SystemData* system)
+{
+	const std::shared_ptr<ThemeData>& theme = system->getTheme();
 
-				e.data.logo = std::shared_ptr<GuiComponent>(logo);
-			}
-		}
-		if (!e.data.logo)
+	if(mViewNeedsReload)
+		getViewElements(theme);
+
+	Entry e;
+	e.name = system->getName();
+	e.object = system;
+
+	// make logo
+	if(theme->getElement("system", "logo", "image"))
+	{
+		std::string path = theme->getElement("system", "logo", "image")->get<std::string>("path");
+
+		if(!path.empty() && ResourceManager::getInstance()->fileExists(path))
 		{
-			// no logo in theme; use text
-			TextComponent* text = new TextComponent(mWindow,
-				(*it)->getName(),
-				Font::get(FONT_SIZE_LARGE),
-				0x000000FF,
-				ALIGN_CENTER);
-			text->setSize(mCarousel.logoSize * mCarousel.logoScale);
-			text->applyTheme((*it)->getTheme(), "system", "logoText", ThemeFlags::FONT_PATH | ThemeFlags::FONT_SIZE | ThemeFlags::COLOR | ThemeFlags::FORCE_UPPERCASE);
-			e.data.logo = std::shared_ptr<GuiComponent>(text);
-
-			if (mCarousel.type == VERTICAL || mCarousel.type == VERTICAL_WHEEL)
-				text->setHorizontalAlignment(mCarousel.logoAlignment);
-			else
-				text->setVerticalAlignment(mCarousel.logoAlignment);
+			ImageComponent* logo = new ImageComponent(mWindow, false, false);
+			logo->setMaxSize(mCarousel.logoSize * mCarousel.logoScale);
+			logo->applyTheme(system->getTheme(), "system", "logo", ThemeFlags::PATH | ThemeFlags::COLOR);
+
+			e.data.logo = std::shared_ptr<GuiComponent>(logo);
 		}
+	}
+	if (!e.data.logo)
+	{
+		// no logo in theme; use text
+		TextComponent* text = new TextComponent(mWindow,
+			system->getName(),
+			Font::get(FONT_SIZE_LARGE),
+			0x000000FF,
+			ALIGN_CENTER);
+		text->setSize(mCarousel.logoSize * mCarousel.logoScale);
+		text->applyTheme(system->getTheme(), "system", "logoText", ThemeFlags::FONT_PATH | ThemeFlags::FONT_SIZE | ThemeFlags::COLOR | ThemeFlags::FORCE_UPPERCASE);
+		e.data.logo = std::shared_ptr<GuiComponent>(text);
 
 		if (mCarousel.type == VERTICAL || mCarousel.type == VERTICAL_WHEEL)
-		{
-			if (mCarousel.logoAlignment == ALIGN_LEFT)
-				e.data.logo->setOrigin(0, 0.5);
-			else if (mCarousel.logoAlignment == ALIGN_RIGHT)
-				e.data.logo->setOrigin(1.0, 0.5);
-			else
-				e.data.logo->setOrigin(0.5, 0.5);
-		} else {
-			if (mCarousel.logoAlignment == ALIGN_TOP)
-				e.data.logo->setOrigin(0.5, 0);
-			else if (mCarousel.logoAlignment == ALIGN_BOTTOM)
-				e.data.logo->setOrigin(0.5, 1);
-			else
-				e.data.logo->setOrigin(0.5, 0.5);
-		}
+			text->setHorizontalAlignment(mCarousel.logoAlignment);
+		else
+			text->setVerticalAlignment(mCarousel.logoAlignment);
+	}
+
+	if (mCarousel.type == VERTICAL || mCarousel.type == VERTICAL_WHEEL)
+	{
+		if (mCarousel.logoAlignment == ALIGN_LEFT)
+			e.data.logo->setOrigin(0, 0.5);
+		else if (mCarousel.logoAlignment == ALIGN_RIGHT)
+			e.data.logo->setOrigin(1.0, 0.5);
+		else
+			e.data.logo->setOrigin(0.5, 0.5);
+	} else {
+		if (mCarousel.logoAlignment == ALIGN_TOP)
+			e.data.logo->setOrigin(0.5, 0);
+		else if (mCarousel.logoAlignment == ALIGN_BOTTOM)
+			e.data.logo->setOrigin(0.5, 1);
+		else
+			e.data.logo->setOrigin(0.5, 0.5);
+	}
 
-		Eigen::Vector2f denormalized = mCarousel.logoSize.cwiseProduct(e.data.logo->getOrigin());
-		e.data.logo->setPosition(denormalized.x(), denormalized.y(), 0.0);
+	Eigen::Vector2f denormalized = mCarousel.logoSize.cwiseProduct(e.data.logo->getOrigin());
+	e.data.logo->setPosition(denormalized.x(), denormalized.y(), 0.0);
 
-		// delete any existing extras
-		for (auto extra : e.data.backgroundExtras)
-			delete extra;
-		e.data.backgroundExtras.clear();
+	// delete any existing extras
+	for (auto extra : e.data.backgroundExtras)
+		delete extra;
+	e.data.backgroundExtras.clear();
 
-		// make background extras
-		e.data.backgroundExtras = ThemeData::makeExtras((*it)->getTheme(), "system", mWindow);
+	// make background extras
+	e.data.backgroundExtras = ThemeData::makeExtras(system->getTheme(), "system", mWindow);
 
-		// sort the extras by z-index
-		std::stable_sort(e.data.backgroundExtras.begin(), e.data.backgroundExtras.end(),  [](GuiComponent* a, GuiComponent* b) {
-			return b->getZIndex() > a->getZIndex();
-		});
+	// sort the extras by z-index
+	std::stable_sort(e.data.backgroundExtras.begin(), e.data.backgroundExtras.end(),  [](GuiComponent* a, GuiComponent* b) {
+		return b->getZIndex() > a->getZIndex();
+	});
 
-		this->add(e);
-	}
+	this->add(e);
 }
 
 void SystemView::goToSystem(SystemData* system, bool animate)
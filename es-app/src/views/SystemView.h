@@ -48,6 +48,7 @@ public:
 	virtual void onHide() override;
 
 	void goToSystem(SystemData* system, bool animate);
+	void updateSystems(); // picks up changes to SystemData::sSystemVector, keeping the selected system
 
 	bool input(InputConfig* config, Input input) override;
 	void update(int deltaTime) override;
@@ -63,6 +64,7 @@ protected:
 
 private:
 	void populate();
+	void addSystem(SystemData* system);
 	void getViewElements(const std::shared_ptr<ThemeData>& theme);
 	void getDefaultElements(void);
 	void getCarouselFromTheme(const ThemeData::ThemeElement* elem);
@@ -145,7 +145,7 @@ void ViewController::goToRandomGame()
 			else
 			{
 				goToGameList(*it);
-				std::vector<FileData*> list = (*it)->getRootFolder()->getFilesRecursive(GAME, true);
+				const std::vector<FileData*>& list = (*it)->getDisplayedGames();
 				getGameListView(*it)->setCursor(list.at(target));
 				return;
 			}
@@ -370,8 +370,9 @@ bool ViewController::input(InputConfig* config, Input input)
 	// open menu
 	if(config->isMappedTo("start", input) && input.value != 0)
 	{
-		// open menu
-		mWindow->pushGui(new GuiMenu(mWindow));
+		// the menu can change or reload systems, so it waits until they're all in
+		if(!SystemData::isLoadingSystems())
+			mWindow->pushGui(new GuiMenu(mWindow));
 		return true;
 	}
 
@@ -433,6 +434,32 @@ void ViewController::preload()
 	}
 }
 
+void ViewController::updateSystemList()
+{
+	// views are laid out by system index, keep the camera on the current one if its index moved
+	for(auto it = mGameListViews.begin(); it != mGameListViews.end(); it++)
+	{
+		float offX = getSystemId(it->first) * (float)Renderer::getScreenWidth() - it->second->getPosition().x();
+		it->second->setPosition(it->second->getPosition().x() + offX, it->second->getPosition().y());
+		if(mCurrentView == it->second)
+			mCamera.translation().x() -= offX;
+	}
+
+	if(mSystemListView)
+	{
+		if(mState.viewing == SYSTEM_SELECT)
+		{
+			float offX = getSystemId(mState.getSystem()) * (float)Renderer::getScreenWidth() - mSystemListView->getPosition().x();
+			mSystemListView->setPosition(mSystemListView->getPosition().x() + offX, mSystemListView->getPosition().y());
+			mCamera.translation().x() -= offX;
+		}
+
+		mSystemListView->updateSystems();
+	}
+
+	preload();
+}
+
 void ViewController::reloadGameListView(IGameListView* view, bool reloadTheme)
 {
 	for(auto it = mGameListViews.begin(); it != mGameListViews.end(); it++)
@@ -18,6 +18,9 @@ public:
 	// Caches things so there's no pauses during transitions.
 	void preload();
 
+	// Adds systems that were loaded or moved around since the carousel was built, and preloads their gamelists.
+	void updateSystemList();
+
 	// If a basic view detected a metadata change, it can request to recreate
 	// the current gamelist view (as it may change to be detailed).
 	void reloadGameListView(IGameListView* gamelist, bool reloadTheme = false);
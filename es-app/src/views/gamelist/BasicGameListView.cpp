@@ -36,6 +36,23 @@ void BasicGameListView::onFileChanged(FileData* file, FileChangeType change)
 		return;
 	}
 
+	if(change == FILE_MOVED)
+	{
+		// only one entry needs to move, and only if it's in the folder being shown
+		FileData* cursor = getCursor();
+		FileData* folder = cursor->isPlaceHolder() ? mRoot : cursor->getListingFolder(mRoot->getSystem());
+		if(file->getListingFolder(mRoot->getSystem()) != folder)
+			return;
+
+		const std::vector<FileData*>& files = folder->getChildrenListToDisplay();
+		auto it = std::find(files.begin(), files.end(), file);
+		if(it == files.end())
+			return; // filtered out
+
+		if(files.size() == (size_t)mList.size() && mList.move(file, it - files.begin()))
+			return;
+	}
+
 	ISimpleGameListView::onFileChanged(file, change);
 }
 
@@ -47,7 +64,7 @@ void BasicGameListView::populateList(const std::vector<FileData*>& files)
 	{
 		for(auto it = files.begin(); it != files.end(); it++)
 		{
-			mList.add((*it)->getName(), *it, ((*it)->getType() == FOLDER));
+			mList.add((*it)->getListName(mRoot->getSystem()), *it, ((*it)->getType() == FOLDER));
 		}
 	}
 	else
@@ -65,14 +82,15 @@ void BasicGameListView::setCursor(FileData* cursor)
 {
 	if(!mList.setCursor(cursor) && (!cursor->isPlaceHolder()))
 	{
-		populateList(cursor->getParent()->getChildrenListToDisplay());
+		FileData* folder = cursor->getListingFolder(mRoot->getSystem());
+		populateList(folder->getChildrenListToDisplay());
 		mList.setCursor(cursor);
 
 		// update our cursor stack in case our cursor just got set to some folder we weren't in before
-		if(mCursorStack.empty() || mCursorStack.top() != cursor->getParent())
+		if(mCursorStack.empty() || mCursorStack.top() != folder)
 		{
 			std::stack<FileData*> tmp;
-			FileData* ptr = cursor->getParent();
+			FileData* ptr = folder;
 			while(ptr && ptr != mRoot)
 			{
 				tmp.push(ptr);
@@ -106,7 +124,7 @@ void BasicGameListView::remove(FileData *game, bool deleteFile)
 {
 	if (deleteFile)
 		boost::filesystem::remove(game->getPath());  // actually delete the file on the filesystem
-	FileData* parent = game->getParent();
+	FileData* parent = game->getListingFolder(mRoot->getSystem());
 	if (getCursor() == game)                     // Select next element in list, or prev if none
 	{
 		std::vector<FileData*> siblings = parent->getChildrenListToDisplay();
@@ -127,7 +145,10 @@ void BasicGameListView::remove(FileData *game, bool deleteFile)
 	{
 		addPlaceholder();
 	}
-	delete game;                                 // remove before repopulating (removes from parent)
+	if (parent->linksChildren())
+		parent->unlinkChild(game);               // a collection only links to it, the game stays in its own system
+	else
+		delete game;                             // remove before repopulating (removes from parent)
 	onFileChanged(parent, FILE_REMOVED);           // update the view, with game removed
 }
 
@@ -22,7 +22,7 @@ void GridGameListView::setCursor(FileData* file)
 {
 	if(!mGrid.setCursor(file))
 	{
-		populateList(file->getParent()->getChildrenListToDisplay());
+		populateList(file->getListingFolder(mRoot->getSystem())->getChildrenListToDisplay());
 		mGrid.setCursor(file);
 	}
 }
@@ -40,7 +40,7 @@ void GridGameListView::populateList(const std::vector<FileData*>& files)
 	mGrid.clear();
 	for(auto it = files.begin(); it != files.end(); it++)
 	{
-		mGrid.add((*it)->getName(), (*it)->getThumbnailPath(), *it);
+		mGrid.add((*it)->getListName(mRoot->getSystem()), (*it)->getThumbnailPath(), *it);
 	}
 }
 
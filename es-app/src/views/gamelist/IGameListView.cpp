@@ -29,6 +29,19 @@ bool IGameListView::input(InputConfig* config, Input input)
 	return GuiComponent::input(config, input);
 }
 
+FileData* IGameListView::getCursorFolder()
+{
+	FileData* folder = getCursor()->getListingFolder(mRoot->getSystem());
+	return folder ? folder : mRoot;
+}
+
+SystemData* IGameListView::getCursorSystem()
+{
+	FileData* cursor = getCursor();
+	FileData* folder = cursor->getListingFolder(mRoot->getSystem());
+	return (folder && folder->linksChildren()) ? folder->getSystem() : cursor->getSystem();
+}
+
 void IGameListView::setTheme(const std::shared_ptr<ThemeData>& theme)
 {
 	mTheme = theme;
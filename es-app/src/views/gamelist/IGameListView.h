@@ -20,6 +20,7 @@ public:
 	// Called when a new file is added, a file is removed, a file's metadata changes, or a file's children are sorted.
 	// NOTE: FILE_SORTED is only reported for the topmost FileData, where the sort started.
 	//       Since sorts are recursive, that FileData's children probably changed too.
+	//       FILE_MOVED is reported for a file that was put in its place after it was added or changed.
 	virtual void onFileChanged(FileData* file, FileChangeType change) = 0;
 	
 	// Called whenever the theme changes.
@@ -31,6 +32,11 @@ public:
 	virtual FileData* getCursor() = 0;
 	virtual void setCursor(FileData*) = 0;
 
+	// the folder whose children are shown, the one listing the cursor
+	FileData* getCursorFolder();
+	// the system the cursor is shown for; a game a collection links to is still of its own system
+	SystemData* getCursorSystem();
+
 	virtual bool input(InputConfig* config, Input input) override;
 	virtual void remove(FileData* game, bool deleteFile) = 0;
 
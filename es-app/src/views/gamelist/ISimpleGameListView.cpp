@@ -66,7 +66,7 @@ void ISimpleGameListView::onFileChanged(FileData* file, FileChangeType change)
 	// but this shouldn't happen very often so we'll just always repopulate
 	FileData* cursor = getCursor();
 	if (!cursor->isPlaceHolder()) {
-		populateList(cursor->getParent()->getChildrenListToDisplay());
+		populateList(cursor->getListingFolder(mRoot->getSystem())->getChildrenListToDisplay());
 		setCursor(cursor);
 	}
 	else
@@ -109,7 +109,7 @@ bool ISimpleGameListView::input(InputConfig* config, Input input)
 				Sound::getFromTheme(getTheme(), getName(), "back")->play();
 			}else{
 				onFocusLost();
-				SystemData* systemToView = getCursor()->getSystem();
+				SystemData* systemToView = getCursorSystem();
 				if (systemToView->isCollection())
 				{
 					systemToView = CollectionSystemManager::get()->getSystemToView(systemToView);
@@ -137,7 +137,7 @@ bool ISimpleGameListView::input(InputConfig* config, Input input)
 		}else if (config->isMappedTo("x", input))
 		{
 			// go to random system game
-			FileData* randomGame = getCursor()->getSystem()->getRandomGame();
+			FileData* randomGame = getCursorSystem()->getRandomGame();
 			if (randomGame)
 			{
 				setCursor(randomGame);
@@ -157,13 +157,3 @@ bool ISimpleGameListView::input(InputConfig* config, Input input)
 
 	return IGameListView::input(config, input);
 }
-
-
-
-
-
-
-
-
-
-
@@ -14,6 +14,7 @@ public:
 	// Called when a new file is added, a file is removed, a file's metadata changes, or a file's children are sorted.
 	// NOTE: FILE_SORTED is only reported for the topmost FileData, where the sort started.
 	//       Since sorts are recursive, that FileData's children probably changed too.
+	//       FILE_MOVED is reported for a file that was put in its place after it was added or changed.
 	virtual void onFileChanged(FileData* file, FileChangeType change);
 	
 	// Called whenever the theme changes.
@@ -41,7 +41,11 @@ void Settings::setDefaults()
 
 	mBoolMap["BackgroundJoystickInput"] = false;
 	mBoolMap["ParseGamelistOnly"] = false;
+	mBoolMap["GamelistSnapshots"] = true; // load unchanged gamelists from a binary snapshot in ~/.emulationstation/cache
 	mBoolMap["ShowHiddenFiles"] = false;
+	mBoolMap["WatchLibrary"] = false; // pick up added/removed ROMs while running (Linux only)
+	mBoolMap["ScanCache"] = true;
+	mBoolMap["CaseInsensitiveExtensions"] = false;
 	mBoolMap["DrawFramerate"] = false;
 	mBoolMap["ShowExit"] = true;
 	mBoolMap["Windowed"] = false;
@@ -71,6 +75,9 @@ void Settings::setDefaults()
 	mIntMap["ScreenSaverTime"] = 5*60*1000; // 5 minutes
 	mIntMap["ScraperResizeWidth"] = 400;
 	mIntMap["ScraperResizeHeight"] = 0;
+	mIntMap["SystemLoadThreads"] = 4; // max threads used to build systems at startup, 1 loads them one after another
+	mIntMap["ScanThreads"] = 1; // folders listed at once while scanning a system, raise for network mounted ROMs
+	mIntMap["GamelistSaveDelay"] = 2000; // ms without metadata changes before changed gamelists are written in the background
 	#ifdef _RPI_
 		mIntMap["MaxVRAM"] = 80;
 	#else
@@ -290,7 +290,7 @@ void Window::setAllowSleep(bool sleep)
 	mAllowSleep = sleep;
 }
 
-void Window::renderLoadingScreen()
+void Window::renderLoadingScreen(const std::string& text, float percent)
 {
 	Eigen::Affine3f trans = Eigen::Affine3f::Identity();
 	Renderer::setMatrix(trans);
@@ -302,8 +302,20 @@ void Window::renderLoadingScreen()
 	splash.setPosition((Renderer::getScreenWidth() - splash.getSize().x()) / 2, (Renderer::getScreenHeight() - splash.getSize().y()) / 2 * 0.6f);
 	splash.render(trans);
 
+	if(percent >= 0)
+	{
+		float barWidth = Renderer::getScreenWidth() * 0.6f;
+		float barHeight = round(Renderer::getScreenHeight() * 0.01f);
+		float barX = round((Renderer::getScreenWidth() - barWidth) / 2.0f);
+		float barY = round(Renderer::getScreenHeight() * 0.8f);
+
+		Renderer::setMatrix(trans);
+		Renderer::drawRect(barX, barY, barWidth, barHeight, 0x222222FF);
+		Renderer::drawRect(barX, barY, round(barWidth * std::min(percent, 1.0f)), barHeight, 0x656565FF);
+	}
+
 	auto& font = mDefaultFonts.at(1);
-	TextCache* cache = font->buildTextCache("LOADING...", 0, 0, 0x656565FF);
+	TextCache* cache = font->buildTextCache(text, 0, 0, 0x656565FF);
 	trans = trans.translate(Eigen::Vector3f(round((Renderer::getScreenWidth() - cache->metrics.size.x()) / 2.0f),
 		round(Renderer::getScreenHeight() * 0.835f), 0.0f));
 	Renderer::setMatrix(trans);
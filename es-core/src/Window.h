@@ -54,7 +54,8 @@ public:
 	bool getAllowSleep();
 	void setAllowSleep(bool sleep);
 
-	void renderLoadingScreen();
+	// percent is in [0, 1], a negative value hides the progress bar
+	void renderLoadingScreen(const std::string& text = "LOADING...", float percent = -1);
 
 	void renderHelpPromptsEarly(); // used to render HelpPrompts before a fade
 	void setHelpPrompts(const std::vector<HelpPrompt>& prompts, const HelpStyle& style);
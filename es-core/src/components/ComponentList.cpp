@@ -33,6 +33,15 @@ void ComponentList::addRow(const ComponentListRow& row, bool setCursorHere)
 	}
 }
 
+void ComponentList::clear()
+{
+	for(auto row = mEntries.begin(); row != mEntries.end(); row++)
+		for(auto it = row->data.elements.begin(); it != row->data.elements.end(); it++)
+			removeChild(it->component.get());
+
+	IList<ComponentListRow, void*>::clear();
+}
+
 void ComponentList::onSizeChanged()
 {
 	for(auto it = mEntries.begin(); it != mEntries.end(); it++)
@@ -48,6 +48,7 @@ public:
 	ComponentList(Window* window);
 
 	void addRow(const ComponentListRow& row, bool setCursorHere = false);
+	void clear(); // removes every row
 
 	void textInput(const char* text) override;
 	bool input(InputConfig* config, Input input) override;
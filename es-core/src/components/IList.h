@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <algorithm>
 #include "GuiComponent.h"
 #include "components/ImageComponent.h"
 #include "resources/Font.h"
@@ -174,6 +175,33 @@ public:
 		return false;
 	}
 
+	// moves the entry for obj to index, the cursor stays on the entry it was on
+	bool move(const UserData& obj, int index)
+	{
+		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
+		{
+			if((*it).object == obj)
+			{
+				int from = it - mEntries.begin();
+				if(from < index)
+					std::rotate(it, it + 1, mEntries.begin() + index + 1);
+				else
+					std::rotate(mEntries.begin() + index, it, it + 1);
+
+				if(mCursor == from)
+					mCursor = index;
+				else if(from < mCursor && index >= mCursor)
+					mCursor--;
+				else if(from > mCursor && index <= mCursor)
+					mCursor++;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	inline int size() const { return mEntries.size(); }
 
 protected:
@@ -54,6 +54,7 @@ std::string TextEditComponent::getValue() const
 
 void TextEditComponent::textInput(const char* text)
 {
+	bool changed = false;
 	if(mEditing)
 	{
 		mCursorRepeatDir = 0;
@@ -64,15 +65,20 @@ void TextEditComponent::textInput(const char* text)
 				size_t newCursor = Font::getPrevCursor(mText, mCursor);
 				mText.erase(mText.begin() + newCursor, mText.begin() + mCursor);
 				mCursor = newCursor;
+				changed = true;
 			}
 		}else{
 			mText.insert(mCursor, text);
 			mCursor += strlen(text);
+			changed = true;
 		}
 	}
 
 	onTextChanged();
 	onCursorChanged();
+
+	if(changed && mChangedCallback)
+		mChangedCallback();
 }
 
 void TextEditComponent::startEditing()
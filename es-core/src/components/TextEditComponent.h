@@ -2,6 +2,7 @@
 
 #include "GuiComponent.h"
 #include "components/NinePatchComponent.h"
+#include <functional>
 
 class Font;
 class TextCache;
@@ -30,6 +31,9 @@ public:
 
 	void setCursor(size_t pos);
 
+	// called after every edit the user makes, not when setValue() is used
+	inline void setChangedCallback(const std::function<void()>& callback) { mChangedCallback = callback; }
+
 	virtual std::vector<HelpPrompt> getHelpPrompts() override;
 
 private:
@@ -60,4 +64,6 @@ private:
 
 	std::shared_ptr<Font> mFont;
 	std::unique_ptr<TextCache> mTextCache;
+
+	std::function<void()> mChangedCallback;
 };
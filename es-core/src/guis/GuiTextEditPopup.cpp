@@ -4,8 +4,10 @@
 using namespace Eigen;
 
 GuiTextEditPopup::GuiTextEditPopup(Window* window, const std::string& title, const std::string& initValue, 
-	const std::function<void(const std::string&)>& okCallback, bool multiLine, const char* acceptBtnText)
-	: GuiComponent(window), mBackground(window, ":/frame.png"), mGrid(window, Vector2i(1, 3)), mMultiLine(multiLine)
+	const std::function<void(const std::string&)>& okCallback, bool multiLine, const char* acceptBtnText,
+	const std::function<void(const std::string&)>& changedCallback)
+	: GuiComponent(window), mBackground(window, ":/frame.png"), mGrid(window, Vector2i(1, 3)), mMultiLine(multiLine),
+	mInitValue(initValue), mChangedCallback(changedCallback)
 {
 	addChild(&mBackground);
 	addChild(&mGrid);
@@ -18,9 +20,12 @@ GuiTextEditPopup::GuiTextEditPopup(Window* window, const std::string& title, con
 	if(!multiLine)
 		mText->setCursor(initValue.size());
 
+	if(changedCallback)
+		mText->setChangedCallback([this, changedCallback] { changedCallback(mText->getValue()); });
+
 	std::vector< std::shared_ptr<ButtonComponent> > buttons;
 	buttons.push_back(std::make_shared<ButtonComponent>(mWindow, acceptBtnText, acceptBtnText, [this, okCallback] { okCallback(mText->getValue()); delete this; }));
-	buttons.push_back(std::make_shared<ButtonComponent>(mWindow, "CANCEL", "discard changes", [this] { delete this; }));
+	buttons.push_back(std::make_shared<ButtonComponent>(mWindow, "CANCEL", "discard changes", [this] { cancel(); }));
 
 	mButtonGrid = makeButtonGrid(mWindow, buttons);
 
@@ -57,13 +62,22 @@ bool GuiTextEditPopup::input(InputConfig* config, Input input)
 	// pressing back when not text editing closes us
 	if(config->isMappedTo("b", input) && input.value)
 	{
-		delete this;
+		cancel();
 		return true;
 	}
 
 	return false;
 }
 
+void GuiTextEditPopup::cancel()
+{
+	// whoever followed the typing goes back to what it was
+	if(mChangedCallback && mText->getValue() != mInitValue)
+		mChangedCallback(mInitValue);
+
+	delete this;
+}
+
 std::vector<HelpPrompt> GuiTextEditPopup::getHelpPrompts()
 {
 	std::vector<HelpPrompt> prompts = mGrid.getHelpPrompts();
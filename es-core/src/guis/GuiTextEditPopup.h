@@ -10,13 +10,16 @@ class GuiTextEditPopup : public GuiComponent
 {
 public:
 	GuiTextEditPopup(Window* window, const std::string& title, const std::string& initValue, 
-		const std::function<void(const std::string&)>& okCallback, bool multiLine, const char* acceptBtnText = "OK");
+		const std::function<void(const std::string&)>& okCallback, bool multiLine, const char* acceptBtnText = "OK",
+		const std::function<void(const std::string&)>& changedCallback = nullptr); // changedCallback sees the text as it's typed, and initValue again on cancel
 
 	bool input(InputConfig* config, Input input);
 	void onSizeChanged();
 	std::vector<HelpPrompt> getHelpPrompts() override;
 
 private:
+	void cancel();
+
 	NinePatchComponent mBackground;
 	ComponentGrid mGrid;
 
@@ -25,4 +28,6 @@ private:
 	std::shared_ptr<ComponentGrid> mButtonGrid;
 
 	bool mMultiLine;
+	std::string mInitValue;
+	std::function<void(const std::string&)> mChangedCallback;
 };